@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+#include "array_view.h"
+
+// Массив, который только дописывается одним писателем и одновременно читается из других потоков.
+// Записанные элементы не меняются и не перемещаются для читателя: при росте элементы копируются
+// в новый буфер, а прежний буфер освобождается только вместе с массивом. Поэтому вид, полученный
+// читателем, остается действительным, пока жив массив, а добавление элементов его не задевает.
+// Память прежних буферов не больше памяти текущего
+template <typename T>
+class AppendOnlyArray {
+public:
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    AppendOnlyArray() = default;
+    AppendOnlyArray(const AppendOnlyArray&) = delete;
+    AppendOnlyArray& operator=(const AppendOnlyArray&) = delete;
+
+    ~AppendOnlyArray() {
+        delete head_.load(std::memory_order_relaxed);
+    }
+
+    // Добавление элементов. Вызывается только писателем
+    void Append(ArrayView<T> values) {
+        const size_t size = size_.load(std::memory_order_relaxed);
+        Reserve(size + values.size());
+        std::copy(values.begin(), values.end(), head_.load(std::memory_order_relaxed)->values.get() + size);
+        // Элементы записаны до публикации размера, поэтому читатель, увидевший размер, видит и их
+        size_.store(size + values.size(), std::memory_order_release);
+    }
+
+    void PushBack(const T& value) {
+        Append({&value, 1});
+    }
+
+    // Выделение памяти не меньше чем под capacity элементов. Вызывается только писателем
+    void Reserve(size_t capacity) {
+        Buffer* buffer = head_.load(std::memory_order_relaxed);
+        if (buffer && capacity <= buffer->capacity) {
+            return;
+        }
+        capacity = std::max(capacity, buffer ? buffer->capacity * 2 : MIN_CAPACITY);
+        auto grown = std::make_unique<Buffer>(capacity, std::unique_ptr<Buffer>(buffer));
+        if (buffer) {
+            std::copy_n(buffer->values.get(), size_.load(std::memory_order_relaxed), grown->values.get());
+        }
+        head_.store(grown.release(), std::memory_order_release);
+    }
+
+    [[nodiscard]] size_t size() const {
+        return size_.load(std::memory_order_acquire);
+    }
+
+    // Все элементы, записанные к моменту вызова
+    [[nodiscard]] ArrayView<T> View() const {
+        return View(size());
+    }
+
+    // Первые count элементов. count не больше размера, который уже видел вызывающий
+    [[nodiscard]] ArrayView<T> View(size_t count) const {
+        const Buffer* buffer = head_.load(std::memory_order_acquire);
+        assert(count <= (buffer ? buffer->capacity : 0));
+        return {buffer ? buffer->values.get() : nullptr, count};
+    }
+
+    // Память текущего и прежних буферов
+    [[nodiscard]] size_t GetAllocatedBytes() const {
+        size_t bytes = 0;
+        for (const Buffer* buffer = head_.load(std::memory_order_acquire); buffer; buffer = buffer->previous.get()) {
+            bytes += buffer->capacity * sizeof(T);
+        }
+        return bytes;
+    }
+
+private:
+    static constexpr size_t MIN_CAPACITY = 4;
+
+    // Буфер не меняется после публикации, кроме элементов за размером массива
+    struct Buffer {
+        Buffer(size_t capacity, std::unique_ptr<Buffer> previous)
+                : values(new T[capacity])
+                , capacity(capacity)
+                , previous(std::move(previous)) {
+        }
+
+        std::unique_ptr<T[]> values;
+        size_t capacity;
+        std::unique_ptr<Buffer> previous;   // Его еще могут читать
+    };
+
+    std::atomic<Buffer*> head_ = nullptr;   // Владеет цепочкой буферов
+    std::atomic<size_t> size_ = 0;
+};
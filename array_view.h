@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+// Непрерывный массив без владения памятью: указатель и размер.
+// Массив может лежать в std::vector или в отображенном в память файле индекса
+template <typename T>
+class ArrayView {
+public:
+    ArrayView() = default;
+
+    ArrayView(const T* data, size_t size)
+            : data_(data)
+            , size_(size) {
+    }
+
+    ArrayView(const std::vector<T>& values)  // NOLINT: неявное преобразование из вектора удобно в вызывающем коде
+            : data_(values.data())
+            , size_(values.size()) {
+    }
+
+    [[nodiscard]] const T& operator[](size_t index) const {
+        assert(index < size_);
+        return data_[index];
+    }
+
+    [[nodiscard]] const T* begin() const {
+        return data_;
+    }
+
+    [[nodiscard]] const T* end() const {
+        return data_ + size_;
+    }
+
+    [[nodiscard]] const T& front() const {
+        return (*this)[0];
+    }
+
+    [[nodiscard]] const T& back() const {
+        return (*this)[size_ - 1];
+    }
+
+    [[nodiscard]] const T* data() const {
+        return data_;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return size_;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return size_ == 0;
+    }
+
+    // Часть массива из count элементов, начиная с offset
+    [[nodiscard]] ArrayView SubView(size_t offset, size_t count) const {
+        assert(offset + count <= size_);
+        return {data_ + offset, count};
+    }
+
+private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "array_view.h"
+
+// Запись и чтение двоичного представления индекса. Массивы выравниваются на 8 байт,
+// поэтому их можно читать на месте - из буфера в памяти или из отображенного в память файла
+constexpr size_t BINARY_ALIGNMENT = 8;
+
+// Запись в буфер
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::vector<char>& buffer)
+            : buffer_(buffer) {
+    }
+
+    template <typename T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto* bytes = reinterpret_cast<const char*>(&value);
+        buffer_.insert(buffer_.end(), bytes, bytes + sizeof(T));
+    }
+
+    // Массив записывается с выравниванием. Размер массива сохраняет вызывающий
+    template <typename T>
+    void WriteArray(ArrayView<T> values) {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= BINARY_ALIGNMENT);
+        Align();
+        const auto* bytes = reinterpret_cast<const char*>(values.data());
+        buffer_.insert(buffer_.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+    void Align() {
+        buffer_.resize((buffer_.size() + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT, 0);
+    }
+
+private:
+    std::vector<char>& buffer_;
+};
+
+// Чтение из непрерывной области памяти. Массивы не копируются: возвращаются представления
+// над исходной памятью. При выходе за границы области выбрасывается std::invalid_argument
+class BinaryReader {
+public:
+    BinaryReader(const char* data, size_t size)
+            : data_(data)
+            , size_(size) {
+        if (reinterpret_cast<uintptr_t>(data) % BINARY_ALIGNMENT != 0) {
+            throw std::invalid_argument("Двоичные данные индекса не выровнены");
+        }
+    }
+
+    template <typename T>
+    T Read() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        CheckAvailable(sizeof(T));
+        T value;
+        std::memcpy(&value, data_ + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return value;
+    }
+
+    template <typename T>
+    ArrayView<T> ReadArray(uint64_t count) {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= BINARY_ALIGNMENT);
+        Align();
+        if (count > (size_ - offset_) / sizeof(T)) {
+            throw std::invalid_argument("Двоичные данные индекса повреждены: массив выходит за границы");
+        }
+        const auto* values = reinterpret_cast<const T*>(data_ + offset_);
+        offset_ += count * sizeof(T);
+        return {values, static_cast<size_t>(count)};
+    }
+
+    void Align() {
+        offset_ = std::min(size_, (offset_ + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT);
+    }
+
+    [[nodiscard]] bool AtEnd() const {
+        return offset_ == size_;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+
+    void CheckAvailable(size_t size) const {
+        if (size > size_ - offset_) {
+            throw std::invalid_argument("Двоичные данные индекса повреждены: неожиданный конец данных");
+        }
+    }
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Битовая карта фиксированного размера. Используется для множеств номеров документов:
+// один бит на документ, проверка принадлежности - одна операция с машинным словом
+class Bitmap {
+public:
+    Bitmap() = default;
+
+    explicit Bitmap(size_t size) {
+        Resize(size);
+    }
+
+    // Изменение размера. Новые биты равны нулю
+    void Resize(size_t size) {
+        words_.resize((size + WORD_BITS - 1) / WORD_BITS, 0);
+        size_ = size;
+    }
+
+    void Set(size_t position) {
+        words_[position / WORD_BITS] |= uint64_t{1} << (position % WORD_BITS);
+    }
+
+    void Reset(size_t position) {
+        words_[position / WORD_BITS] &= ~(uint64_t{1} << (position % WORD_BITS));
+    }
+
+    [[nodiscard]] bool Test(size_t position) const {
+        return (words_[position / WORD_BITS] >> (position % WORD_BITS)) & 1;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return size_;
+    }
+
+    [[nodiscard]] size_t GetAllocatedBytes() const {
+        return words_.capacity() * sizeof(uint64_t);
+    }
+
+private:
+    static constexpr size_t WORD_BITS = 64;
+
+    std::vector<uint64_t> words_;
+    size_t size_ = 0;
+};
+
+// Битовая карта, которую копии разделяют кусками по CHUNK_BITS бит. Копирование копирует только
+// указатели на куски, а изменение бита копирует один кусок, если его разделяет другая копия.
+// Используется для отметок об удалении: копия сегмента индекса и отметка в ней не зависят
+// от числа документов сегмента, кроме копирования указателей
+class ChunkedBitmap {
+public:
+    static constexpr size_t CHUNK_BITS = 4096;
+
+    ChunkedBitmap() = default;
+
+    explicit ChunkedBitmap(size_t size) {
+        Resize(size);
+    }
+
+    // Изменение размера. Новые биты равны нулю
+    void Resize(size_t size) {
+        const size_t chunk_count = (size + CHUNK_BITS - 1) / CHUNK_BITS;
+        chunks_.resize(std::min(chunks_.size(), chunk_count));
+        while (chunks_.size() < chunk_count) {
+            chunks_.push_back(std::make_shared<Chunk>());
+        }
+        size_ = size;
+    }
+
+    void Set(size_t position) {
+        GetMutableWord(position) |= uint64_t{1} << (position % WORD_BITS);
+    }
+
+    void Reset(size_t position) {
+        GetMutableWord(position) &= ~(uint64_t{1} << (position % WORD_BITS));
+    }
+
+    [[nodiscard]] bool Test(size_t position) const {
+        const Chunk& chunk = *chunks_[position / CHUNK_BITS];
+        return (chunk[position % CHUNK_BITS / WORD_BITS] >> (position % WORD_BITS)) & 1;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return size_;
+    }
+
+    // Память кусков, в том числе разделяемых с другими копиями
+    [[nodiscard]] size_t GetAllocatedBytes() const {
+        return chunks_.size() * sizeof(Chunk) + chunks_.capacity() * sizeof(chunks_[0]);
+    }
+
+private:
+    static constexpr size_t WORD_BITS = 64;
+
+    using Chunk = std::array<uint64_t, CHUNK_BITS / WORD_BITS>;
+
+    std::vector<std::shared_ptr<Chunk>> chunks_;
+    size_t size_ = 0;
+
+    // Слово для изменения: разделяемый кусок сначала копируется
+    uint64_t& GetMutableWord(size_t position) {
+        auto& chunk = chunks_[position / CHUNK_BITS];
+        if (chunk.use_count() > 1) {
+            chunk = std::make_shared<Chunk>(*chunk);
+        } else {
+            // Последняя чужая ссылка могла быть освобождена в другом потоке
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return (*chunk)[position % CHUNK_BITS / WORD_BITS];
+    }
+};
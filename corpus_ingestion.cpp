@@ -0,0 +1,262 @@
+#include "corpus_ingestion.h"
+
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+#include "string_processing.h"
+
+using namespace std::literals;
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace {
+
+// Очередь ограниченного размера: Push ждет, пока в очереди не освободится место
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity)
+            : capacity_(std::max<size_t>(1, capacity)) {
+    }
+
+    // Добавление элемента. Возвращает false, если очередь закрыта и элемент не нужен
+    bool Push(T value) {
+        std::unique_lock guard(mutex_);
+        not_full_.wait(guard, [this] {
+            return closed_ || items_.size() < capacity_;
+        });
+        if (closed_) {
+            return false;
+        }
+        items_.push_back(std::move(value));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Извлечение элемента. Для закрытой и пустой очереди возвращает std::nullopt
+    std::optional<T> Pop() {
+        std::unique_lock guard(mutex_);
+        not_empty_.wait(guard, [this] {
+            return closed_ || !items_.empty();
+        });
+        if (items_.empty()) {
+            return std::nullopt;
+        }
+        T value = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return value;
+    }
+
+    // Закрытие очереди: новые элементы не принимаются, оставшиеся можно извлечь
+    void Close() {
+        std::lock_guard guard(mutex_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    const size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+// Пакет разобранных документов и число строк, которые не удалось разобрать
+struct DocumentBatch {
+    vector<NewDocument> documents;
+    size_t rejected_line_count = 0;
+};
+
+int ParseInteger(string_view text) {
+    int value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc{} || end != text.data() + text.size()) {
+        throw std::invalid_argument("Некорректное число в строке корпуса: "s + string(text));
+    }
+    return value;
+}
+
+DocumentStatus ParseStatus(string_view text) {
+    if (text == "ACTUAL"sv) {
+        return DocumentStatus::ACTUAL;
+    }
+    if (text == "IRRELEVANT"sv) {
+        return DocumentStatus::IRRELEVANT;
+    }
+    if (text == "BANNED"sv) {
+        return DocumentStatus::BANNED;
+    }
+    if (text == "REMOVED"sv) {
+        return DocumentStatus::REMOVED;
+    }
+    throw std::invalid_argument("Неизвестный статус документа в строке корпуса: "s + string(text));
+}
+
+// Отделение очередного поля строки до табуляции
+string_view TakeField(string_view& line) {
+    const size_t tab = line.find('\t');
+    if (tab == string_view::npos) {
+        throw std::invalid_argument("В строке корпуса меньше четырех полей");
+    }
+    const string_view field = line.substr(0, tab);
+    line.remove_prefix(tab + 1);
+    return field;
+}
+
+// Начало строки, которой принадлежит позиция: строка относится к части файла, в которой начинается
+size_t FindLineStart(string_view data, size_t position) {
+    if (position == 0) {
+        return 0;
+    }
+    if (position >= data.size()) {
+        return data.size();
+    }
+    const size_t newline = data.find('\n', position - 1);
+    return newline == string_view::npos ? data.size() : newline + 1;
+}
+
+} // namespace
+
+NewDocument ParseCorpusLine(string_view line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    const int id = ParseInteger(TakeField(line));
+    const DocumentStatus status = ParseStatus(TakeField(line));
+    vector<int> ratings;
+    // Пустое поле рейтингов и лишние пробелы допустимы: документ без рейтингов принимается сервером
+    for (const string_view rating : SplitIntoWords(TakeField(line))) {
+        if (!rating.empty()) {
+            ratings.push_back(ParseInteger(rating));
+        }
+    }
+    return {id, line, status, std::move(ratings)};
+}
+
+double IngestionStats::GetDocumentsPerSecond() const {
+    const double seconds = std::chrono::duration<double>(duration).count();
+    return seconds > 0 ? document_count / seconds : 0.0;
+}
+
+IngestionStats IngestCorpus(SearchServer& server, const string& path, const IngestionOptions& options, std::ostream& progress) {
+    using Clock = std::chrono::steady_clock;
+    const auto start_time = Clock::now();
+    const auto file = MappedFile::Open(path);
+    const string_view data(file->data(), file->size());
+    const size_t chunk_size = std::max<size_t>(1, options.chunk_size);
+    const size_t chunk_count = (data.size() + chunk_size - 1) / chunk_size;
+    const size_t batch_size = std::max<size_t>(1, options.batch_size);
+    const size_t thread_count = std::max<size_t>(1, options.thread_count);
+
+    BoundedQueue<DocumentBatch> queue(options.max_pending_batches);
+    std::atomic<size_t> next_chunk = 0;
+    std::atomic<size_t> active_readers = thread_count;
+    std::mutex error_mutex;
+    std::exception_ptr reader_error;
+
+    // Потоки разбора берут части файла по очереди. Пакет потока переходит через границу частей,
+    // поэтому пакеты получаются полными независимо от размера частей
+    const auto read_chunks = [&] {
+        try {
+            DocumentBatch batch;
+            bool accepted = true;
+            for (size_t chunk = next_chunk++; chunk < chunk_count && accepted; chunk = next_chunk++) {
+                const size_t end = FindLineStart(data, (chunk + 1) * chunk_size);
+                for (size_t begin = FindLineStart(data, chunk * chunk_size); begin < end && accepted;) {
+                    const size_t newline = data.find('\n', begin);
+                    // Часть заканчивается на границе строки, поэтому строка не выходит за ее пределы
+                    const size_t line_end = newline == string_view::npos ? data.size() : newline;
+                    const string_view line = data.substr(begin, line_end - begin);
+                    begin = line_end + 1;
+                    if (line.empty() || line == "\r"sv) {
+                        continue;
+                    }
+                    try {
+                        batch.documents.push_back(ParseCorpusLine(line));
+                    } catch (const std::invalid_argument&) {
+                        ++batch.rejected_line_count;
+                    }
+                    if (batch.documents.size() == batch_size) {
+                        accepted = queue.Push(std::exchange(batch, {}));
+                    }
+                }
+            }
+            if (accepted && (!batch.documents.empty() || batch.rejected_line_count > 0)) {
+                queue.Push(std::move(batch));
+            }
+        } catch (...) {
+            std::lock_guard guard(error_mutex);
+            reader_error = std::current_exception();
+            queue.Close();
+        }
+        // Последний поток разбора закрывает очередь, и добавление завершается, когда очередь опустеет
+        if (--active_readers == 0) {
+            queue.Close();
+        }
+    };
+
+    vector<std::thread> readers;
+    readers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        readers.emplace_back(read_chunks);
+    }
+
+    IngestionStats stats;
+    stats.byte_count = data.size();
+    auto last_report_time = start_time;
+    try {
+        // Пакеты добавляются по одному: AddDocuments сам разбирает тексты пакета в нескольких потоках
+        while (auto batch = queue.Pop()) {
+            stats.rejected_line_count += batch->rejected_line_count;
+            try {
+                server.AddDocuments(batch->documents);
+                stats.document_count += batch->documents.size();
+            } catch (const std::invalid_argument&) {
+                for (const NewDocument& document : batch->documents) {
+                    try {
+                        server.AddDocument(document.id, document.text, document.status, document.ratings);
+                        ++stats.document_count;
+                    } catch (const std::invalid_argument&) {
+                        ++stats.rejected_line_count;
+                    }
+                }
+            }
+            const auto now = Clock::now();
+            if (options.report_interval.count() > 0 && now - last_report_time >= options.report_interval) {
+                stats.duration = now - start_time;
+                progress << "Indexed "s << stats.document_count << " documents, "s
+                         << static_cast<size_t>(stats.GetDocumentsPerSecond()) << " docs/s"s << std::endl;
+                last_report_time = now;
+            }
+        }
+    } catch (...) {
+        queue.Close();
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+        throw;
+    }
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    if (reader_error) {
+        std::rethrow_exception(reader_error);
+    }
+    stats.duration = Clock::now() - start_time;
+    return stats;
+}
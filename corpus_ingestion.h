@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "search_server.h"
+
+// Загрузка корпуса документов из файла. Каждая строка файла - документ из четырех полей,
+// разделенных табуляцией: id, статус (ACTUAL, IRRELEVANT, BANNED, REMOVED), рейтинги через пробел и текст.
+// Например: "17\tACTUAL\t5 -2 8\tfunny pet with curly hair"
+
+// Разбор строки корпуса. Текст документа ссылается на line.
+// При ошибке в строке выбрасывается std::invalid_argument
+NewDocument ParseCorpusLine(std::string_view line);
+
+struct IngestionOptions {
+    // Сколько потоков разбирают строки файла
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    // Размер части файла, которую поток разбирает за один раз
+    size_t chunk_size = 4 << 20;
+    // Сколько документов добавляется на сервер одним вызовом AddDocuments
+    size_t batch_size = SearchServer::WRITE_SEGMENT_CAPACITY;
+    // Сколько разобранных пакетов может ждать добавления. Когда очередь заполнена,
+    // потоки разбора ждут, поэтому память под пакеты ограничена
+    size_t max_pending_batches = 4;
+    // Как часто выводить прогресс. Нулевой интервал отключает вывод
+    std::chrono::milliseconds report_interval{1000};
+};
+
+struct IngestionStats {
+    size_t document_count = 0;          // Добавлено документов
+    size_t rejected_line_count = 0;     // Строк с ошибками разбора или документов, которые сервер не принял
+    size_t byte_count = 0;              // Размер файла
+    std::chrono::steady_clock::duration duration{};
+
+    [[nodiscard]] double GetDocumentsPerSecond() const;
+};
+
+// Потоковая загрузка корпуса на сервер. Файл отображается в память и делится на части по границам строк;
+// потоки разбирают части в пакеты документов, а пакеты добавляются на сервер через AddDocuments по одному.
+// Тексты документов не копируются до добавления на сервер. Если сервер не принимает пакет целиком
+// (например, из-за повторяющегося id), документы пакета добавляются по одному, а отклоненные учитываются
+// в rejected_line_count. Прогресс и скорость загрузки выводятся в progress
+IngestionStats IngestCorpus(SearchServer& server, const std::string& path, const IngestionOptions& options = {},
+                            std::ostream& progress = std::cerr);
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 
+// Внутренний плотный номер документа на сервере. Внешние id документов
+// переводятся в номера только на границе API
+using DocumentOrdinal = uint32_t;
+
 struct Document {
     Document() = default;
     Document(int id, double relevance, int rating);
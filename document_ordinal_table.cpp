@@ -0,0 +1,81 @@
+#include "document_ordinal_table.h"
+
+DocumentOrdinalTable::Table::Table(size_t capacity, std::unique_ptr<Table> previous)
+        : slots(new std::atomic<uint64_t>[capacity])
+        , capacity(capacity)
+        , previous(std::move(previous)) {
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+DocumentOrdinalTable::~DocumentOrdinalTable() {
+    delete table_.load(std::memory_order_relaxed);
+}
+
+void DocumentOrdinalTable::InsertOrAssign(int document_id, DocumentOrdinal ordinal) {
+    const uint64_t value = (uint64_t{static_cast<uint32_t>(document_id)} << 32) | (uint64_t{ordinal} + 1);
+    Table* table = table_.load(std::memory_order_relaxed);
+    // Таблица заполнена не больше чем наполовину. Перед ростом считается, что id новый: лишний рост не страшен
+    if (!table || (size_ + 1) * 2 > table->capacity) {
+        const size_t capacity = table ? table->capacity * 2 : MIN_CAPACITY;
+        auto grown = std::make_unique<Table>(capacity, std::unique_ptr<Table>(table));
+        if (table) {
+            for (size_t i = 0; i < table->capacity; ++i) {
+                const uint64_t slot = table->slots[i].load(std::memory_order_relaxed);
+                if (slot != 0) {
+                    Store(*grown, static_cast<int>(slot >> 32), slot);
+                }
+            }
+        }
+        table = grown.release();
+        table_.store(table, std::memory_order_release);
+    }
+    const size_t mask = table->capacity - 1;
+    for (size_t i = GetSlot(document_id, table->capacity);; i = (i + 1) & mask) {
+        const uint64_t slot = table->slots[i].load(std::memory_order_relaxed);
+        if (slot == 0 || static_cast<uint32_t>(slot >> 32) == static_cast<uint32_t>(document_id)) {
+            size_ += slot == 0;
+            table->slots[i].store(value, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+std::optional<DocumentOrdinal> DocumentOrdinalTable::Find(int document_id) const {
+    const Table* table = table_.load(std::memory_order_acquire);
+    if (!table) {
+        return std::nullopt;
+    }
+    const size_t mask = table->capacity - 1;
+    for (size_t i = GetSlot(document_id, table->capacity);; i = (i + 1) & mask) {
+        const uint64_t slot = table->slots[i].load(std::memory_order_acquire);
+        if (slot == 0) {
+            return std::nullopt;
+        }
+        if (static_cast<uint32_t>(slot >> 32) == static_cast<uint32_t>(document_id)) {
+            return static_cast<DocumentOrdinal>(static_cast<uint32_t>(slot) - 1);
+        }
+    }
+}
+
+size_t DocumentOrdinalTable::GetAllocatedBytes() const {
+    size_t bytes = 0;
+    for (const Table* table = table_.load(std::memory_order_acquire); table; table = table->previous.get()) {
+        bytes += table->capacity * sizeof(uint64_t) + sizeof(Table);
+    }
+    return bytes;
+}
+
+size_t DocumentOrdinalTable::GetSlot(int document_id, size_t capacity) {
+    return static_cast<size_t>((uint64_t{static_cast<uint32_t>(document_id)} * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+}
+
+void DocumentOrdinalTable::Store(Table& table, int document_id, uint64_t value) {
+    const size_t mask = table.capacity - 1;
+    size_t i = GetSlot(document_id, table.capacity);
+    while (table.slots[i].load(std::memory_order_relaxed) != 0) {
+        i = (i + 1) & mask;
+    }
+    table.slots[i].store(value, std::memory_order_relaxed);
+}
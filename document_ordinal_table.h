@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "document.h"
+
+// Таблица номеров документов незапечатанного сегмента по внешнему id: открытая адресация, один писатель.
+// Ячейки атомарные, а прежние версии таблицы после роста освобождаются только вместе с ней,
+// поэтому искать можно одновременно с добавлением
+class DocumentOrdinalTable {
+public:
+    DocumentOrdinalTable() = default;
+    DocumentOrdinalTable(const DocumentOrdinalTable&) = delete;
+    DocumentOrdinalTable& operator=(const DocumentOrdinalTable&) = delete;
+
+    ~DocumentOrdinalTable();
+
+    // Добавление или замена номера документа. Вызывается только писателем
+    void InsertOrAssign(int document_id, DocumentOrdinal ordinal);
+
+    // Последний записанный номер документа
+    [[nodiscard]] std::optional<DocumentOrdinal> Find(int document_id) const;
+
+    // Память текущей и прежних версий таблицы
+    [[nodiscard]] size_t GetAllocatedBytes() const;
+
+private:
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    // Ячейка хранит id в старших 32 битах и номер документа, увеличенный на 1, в младших. Пустая ячейка равна 0
+    struct Table {
+        explicit Table(size_t capacity, std::unique_ptr<Table> previous);
+
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+        size_t capacity;                    // Степень двойки
+        std::unique_ptr<Table> previous;    // Ее еще могут читать
+    };
+
+    std::atomic<Table*> table_ = nullptr;   // Владеет цепочкой версий
+    size_t size_ = 0;                       // Читается только писателем
+
+    static size_t GetSlot(int document_id, size_t capacity);
+
+    // Вставка в таблицу, где заведомо есть место
+    static void Store(Table& table, int document_id, uint64_t value);
+};
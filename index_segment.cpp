@@ -0,0 +1,482 @@
+#include "index_segment.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+
+#include "binary_io.h"
+
+IndexSegment::IndexSegment()
+        : builder_(std::make_shared<Builder>()) {
+    UpdateViews();
+}
+
+IndexSegment IndexSegment::Open(std::shared_ptr<const void> storage, ArrayView<char> bytes, size_t term_count) {
+    IndexSegment segment;
+    segment.builder_.reset();
+    segment.ReadBytes(bytes);
+    segment.CheckContents(term_count);
+    segment.storage_ = std::move(storage);
+    segment.is_external_ = true;
+    segment.deleted_ = ChunkedBitmap(segment.GetOrdinalCount());
+    return segment;
+}
+
+DocumentOrdinal IndexSegment::AddDocument(DocumentData document) {
+    std::vector<TermId> term_ids;
+    std::vector<double> term_freqs;
+    term_ids.reserve(document.word_freqs.size());
+    term_freqs.reserve(document.word_freqs.size());
+    for (const auto [term_id, term_freq] : document.word_freqs) {
+        term_ids.push_back(term_id);
+        term_freqs.push_back(term_freq);
+    }
+    return AppendDocument({document.id, document.rating, document.status}, document.text, {term_ids, term_freqs});
+}
+
+DocumentOrdinal IndexSegment::AddDocument(const DocumentView& document) {
+    return AppendDocument(document.info, document.text, document.word_freqs);
+}
+
+void IndexSegment::RemoveDocument(DocumentOrdinal ordinal) {
+    if (!deleted_.Test(ordinal)) {
+        deleted_.Set(ordinal);
+        ++deleted_count_;
+    }
+}
+
+std::optional<DocumentOrdinal> IndexSegment::FindDocument(int document_id) const {
+    std::optional<DocumentOrdinal> ordinal;
+    if (builder_) {
+        ordinal = builder_->document_ordinals.Find(document_id);
+        // Документ с тем же id мог быть добавлен заново уже после границы этой копии сегмента,
+        // тогда среди своих документов ищется последний с этим id
+        if (ordinal && *ordinal >= GetOrdinalCount()) {
+            ordinal.reset();
+            for (size_t i = GetOrdinalCount(); i > 0; --i) {
+                if (infos_[i - 1].id == document_id) {
+                    ordinal = static_cast<DocumentOrdinal>(i - 1);
+                    break;
+                }
+            }
+        }
+    } else {
+        const auto found = std::lower_bound(document_entries_.begin(), document_entries_.end(), document_id,
+                                            [](const DocumentEntry& entry, int id) {
+                                                return entry.id < id;
+                                            });
+        if (found != document_entries_.end() && found->id == document_id) {
+            ordinal = found->ordinal;
+        }
+    }
+    if (!ordinal || deleted_.Test(*ordinal)) {
+        return std::nullopt;
+    }
+    return ordinal;
+}
+
+WordFreqsView IndexSegment::GetWordFreqs(DocumentOrdinal ordinal) const {
+    const uint64_t begin = forward_offsets_[ordinal];
+    const uint64_t count = forward_offsets_[ordinal + 1] - begin;
+    return {forward_term_ids_.SubView(begin, count), forward_freqs_.SubView(begin, count)};
+}
+
+std::string_view IndexSegment::GetText(DocumentOrdinal ordinal) const {
+    if (builder_) {
+        return texts_[ordinal];
+    }
+    const uint64_t begin = text_offsets_[ordinal];
+    return {text_.data() + begin, static_cast<size_t>(text_offsets_[ordinal + 1] - begin)};
+}
+
+PostingListView IndexSegment::GetPostings(TermId term_id) const {
+    if (builder_) {
+        return term_id < word_to_document_freqs_.size() ? word_to_document_freqs_[term_id]->View(GetOrdinalCount()) : PostingListView{};
+    }
+    if (term_id + 1 >= posting_offsets_.size()) {
+        return {};
+    }
+    const uint64_t begin = posting_offsets_[term_id];
+    const uint64_t count = posting_offsets_[term_id + 1] - begin;
+    const uint64_t block_begin = block_offsets_[term_id];
+    const uint64_t block_count = block_offsets_[term_id + 1] - block_begin;
+    return {posting_ordinals_.SubView(begin, count), posting_freqs_.SubView(begin, count),
+            block_last_ordinals_.SubView(block_begin, block_count)};
+}
+
+size_t IndexSegment::GetDocumentCount() const {
+    return infos_.size() - deleted_count_;
+}
+
+size_t IndexSegment::GetDeletedCount() const {
+    return deleted_count_;
+}
+
+size_t IndexSegment::GetOrdinalCount() const {
+    return infos_.size();
+}
+
+size_t IndexSegment::GetTermCount() const {
+    return builder_ ? word_to_document_freqs_.size() : posting_offsets_.size() - 1;
+}
+
+bool IndexSegment::SharesData(const IndexSegment& other) const {
+    return builder_ ? builder_ == other.builder_ : !other.builder_ && bytes_.data() == other.bytes_.data();
+}
+
+bool IndexSegment::IsSealed() const {
+    return !builder_;
+}
+
+void IndexSegment::Seal() {
+    if (!builder_) {
+        return;
+    }
+    // Данные builder_ могут читать копии сегмента, поэтому двоичное представление строится рядом,
+    // а builder_ освобождается последней копией
+    std::vector<DocumentView> documents;
+    documents.reserve(GetOrdinalCount());
+    AppendDocumentViews(documents, false);
+    IndexSegment sealed = Build(documents);
+    sealed.deleted_ = std::move(deleted_);
+    sealed.deleted_count_ = deleted_count_;
+    *this = std::move(sealed);
+}
+
+ArrayView<char> IndexSegment::GetBytes() const {
+    assert(IsSealed());
+    return bytes_;
+}
+
+// Двоичное представление сегмента: заголовок из количеств элементов, затем массивы документов,
+// списков вхождений и таблица id документов. Каждый массив выровнен на 8 байт
+IndexSegment IndexSegment::Build(const std::vector<DocumentView>& documents) {
+    if (documents.size() >= std::numeric_limits<DocumentOrdinal>::max()) {
+        throw std::invalid_argument("Слишком много документов для одного сегмента");
+    }
+    size_t forward_count = 0;
+    size_t text_size = 0;
+    size_t term_count = 0;
+    for (const DocumentView& document : documents) {
+        forward_count += document.word_freqs.term_ids.size();
+        text_size += document.text.size();
+        if (!document.word_freqs.term_ids.empty()) {
+            // Термы документа упорядочены, поэтому последний из них - наибольший
+            term_count = std::max<size_t>(term_count, document.word_freqs.term_ids.back() + 1);
+        }
+    }
+
+    std::vector<DocumentInfo> infos;
+    std::vector<uint64_t> forward_offsets{0};
+    std::vector<TermId> forward_term_ids;
+    std::vector<double> forward_freqs;
+    std::vector<uint64_t> text_offsets{0};
+    std::vector<char> text;
+    std::vector<uint64_t> posting_offsets(term_count + 1, 0);
+    infos.reserve(documents.size());
+    forward_offsets.reserve(documents.size() + 1);
+    forward_term_ids.reserve(forward_count);
+    forward_freqs.reserve(forward_count);
+    text_offsets.reserve(documents.size() + 1);
+    text.reserve(text_size);
+    for (const DocumentView& document : documents) {
+        infos.push_back(document.info);
+        forward_term_ids.insert(forward_term_ids.end(), document.word_freqs.term_ids.begin(), document.word_freqs.term_ids.end());
+        forward_freqs.insert(forward_freqs.end(), document.word_freqs.term_freqs.begin(), document.word_freqs.term_freqs.end());
+        forward_offsets.push_back(forward_term_ids.size());
+        text.insert(text.end(), document.text.begin(), document.text.end());
+        text_offsets.push_back(text.size());
+        for (const TermId term_id : document.word_freqs.term_ids) {
+            ++posting_offsets[term_id + 1];
+        }
+    }
+    std::partial_sum(posting_offsets.begin(), posting_offsets.end(), posting_offsets.begin());
+
+    // Документы перебираются по возрастанию номеров, поэтому списки вхождений получаются упорядоченными
+    std::vector<DocumentOrdinal> posting_ordinals(forward_count);
+    std::vector<double> posting_freqs(forward_count);
+    std::vector<uint64_t> positions(posting_offsets.begin(), posting_offsets.end() - 1);
+    for (DocumentOrdinal ordinal = 0; ordinal < documents.size(); ++ordinal) {
+        for (uint64_t i = forward_offsets[ordinal]; i < forward_offsets[ordinal + 1]; ++i) {
+            const uint64_t position = positions[forward_term_ids[i]]++;
+            posting_ordinals[position] = ordinal;
+            posting_freqs[position] = forward_freqs[i];
+        }
+    }
+    // Указатели пропуска: последний номер каждого блока, в том числе неполного
+    std::vector<uint64_t> block_offsets{0};
+    std::vector<DocumentOrdinal> block_last_ordinals;
+    block_offsets.reserve(term_count + 1);
+    for (size_t term_id = 0; term_id < term_count; ++term_id) {
+        for (uint64_t begin = posting_offsets[term_id]; begin < posting_offsets[term_id + 1]; begin += PostingListView::BLOCK_SIZE) {
+            block_last_ordinals.push_back(posting_ordinals[std::min(begin + PostingListView::BLOCK_SIZE, posting_offsets[term_id + 1]) - 1]);
+        }
+        block_offsets.push_back(block_last_ordinals.size());
+    }
+    // Для повторного id в таблице остается последний добавленный документ
+    std::vector<DocumentEntry> document_entries;
+    document_entries.reserve(documents.size());
+    for (DocumentOrdinal ordinal = 0; ordinal < documents.size(); ++ordinal) {
+        document_entries.push_back({infos[ordinal].id, ordinal});
+    }
+    std::sort(document_entries.begin(), document_entries.end(), [](const DocumentEntry& lhs, const DocumentEntry& rhs) {
+        return lhs.id < rhs.id || (lhs.id == rhs.id && lhs.ordinal < rhs.ordinal);
+    });
+    document_entries.erase(document_entries.begin(),
+                           std::unique(document_entries.rbegin(), document_entries.rend(),
+                                       [](const DocumentEntry& lhs, const DocumentEntry& rhs) {
+                                           return lhs.id == rhs.id;
+                                       }).base());
+
+    std::vector<char> bytes;
+    const auto array_bytes = [](const auto& values) {
+        return values.size() * sizeof(values[0]) + BINARY_ALIGNMENT;
+    };
+    bytes.reserve(7 * sizeof(uint64_t) + array_bytes(infos) + array_bytes(forward_offsets) + array_bytes(forward_term_ids)
+                  + array_bytes(forward_freqs) + array_bytes(text_offsets) + array_bytes(text) + array_bytes(posting_offsets)
+                  + array_bytes(posting_ordinals) + array_bytes(posting_freqs) + array_bytes(block_offsets)
+                  + array_bytes(block_last_ordinals) + array_bytes(document_entries));
+    BinaryWriter writer(bytes);
+    writer.Write<uint64_t>(infos.size());
+    writer.Write<uint64_t>(term_count);
+    writer.Write<uint64_t>(posting_ordinals.size());
+    writer.Write<uint64_t>(block_last_ordinals.size());
+    writer.Write<uint64_t>(forward_term_ids.size());
+    writer.Write<uint64_t>(text.size());
+    writer.Write<uint64_t>(document_entries.size());
+    writer.WriteArray<DocumentInfo>(infos);
+    writer.WriteArray<uint64_t>(forward_offsets);
+    writer.WriteArray<TermId>(forward_term_ids);
+    writer.WriteArray<double>(forward_freqs);
+    writer.WriteArray<uint64_t>(text_offsets);
+    writer.WriteArray<char>(text);
+    writer.WriteArray<uint64_t>(posting_offsets);
+    writer.WriteArray<DocumentOrdinal>(posting_ordinals);
+    writer.WriteArray<double>(posting_freqs);
+    writer.WriteArray<uint64_t>(block_offsets);
+    writer.WriteArray<DocumentOrdinal>(block_last_ordinals);
+    writer.WriteArray<DocumentEntry>(document_entries);
+    writer.Align();
+
+    IndexSegment segment;
+    segment.builder_.reset();
+    auto storage = std::make_shared<const std::vector<char>>(std::move(bytes));
+    segment.ReadBytes(*storage);
+    segment.storage_ = std::move(storage);
+    segment.deleted_ = ChunkedBitmap(segment.GetOrdinalCount());
+    return segment;
+}
+
+IndexSegment IndexSegment::Merge(const std::vector<std::shared_ptr<const IndexSegment>>& segments) {
+    std::vector<DocumentView> documents;
+    for (const auto& segment : segments) {
+        segment->AppendDocumentViews(documents, true);
+    }
+    return Build(documents);
+}
+
+IndexSegment IndexSegment::Compact() const {
+    return CollectDocuments({this});
+}
+
+void IndexSegment::AddMemoryUsage(MemoryStats& stats) const {
+    const auto array_bytes = [](const auto& values) {
+        return values.size() * sizeof(values[0]);
+    };
+    stats.documents.bytes += deleted_.GetAllocatedBytes();
+    stats.documents.elements += GetOrdinalCount();
+    stats.forward_index.elements += forward_term_ids_.size();
+    if (builder_) {
+        // Другая копия сегмента может дописывать builder_ одновременно, поэтому списки вхождений
+        // читаются до своей границы, а память считается вместе с прежними буферами массивов
+        const Builder& builder = *builder_;
+        for (const AppendOnlyPostingList* postings : word_to_document_freqs_) {
+            stats.inverted_index.bytes += postings->GetAllocatedBytes();
+            stats.inverted_index.elements += postings->View(GetOrdinalCount()).size();
+        }
+        stats.inverted_index.bytes += builder.word_to_document_freqs.GetAllocatedBytes()
+                                    + word_to_document_freqs_.size() * sizeof(AppendOnlyPostingList);
+        stats.forward_index.bytes += builder.forward_offsets.GetAllocatedBytes() + builder.forward_term_ids.GetAllocatedBytes()
+                                   + builder.forward_freqs.GetAllocatedBytes();
+        stats.documents.bytes += builder.infos.GetAllocatedBytes() + builder.document_ordinals.GetAllocatedBytes();
+        stats.document_texts.bytes += builder.text_arena.GetCapacity() + builder.texts.GetAllocatedBytes();
+        for (const std::string_view text : texts_) {
+            stats.document_texts.elements += text.size();
+        }
+        return;
+    }
+    const size_t inverted_index_bytes = array_bytes(posting_offsets_) + array_bytes(posting_ordinals_) + array_bytes(posting_freqs_)
+                                      + array_bytes(block_offsets_) + array_bytes(block_last_ordinals_);
+    const size_t forward_index_bytes = array_bytes(forward_offsets_) + array_bytes(forward_term_ids_) + array_bytes(forward_freqs_);
+    const size_t text_bytes = array_bytes(text_offsets_) + array_bytes(text_);
+    stats.inverted_index.bytes += inverted_index_bytes;
+    stats.inverted_index.elements += posting_ordinals_.size();
+    stats.forward_index.bytes += forward_index_bytes;
+    stats.document_texts.bytes += text_bytes;
+    stats.document_texts.elements += text_.size();
+    // Заголовок и выравнивание массивов тоже относятся к документам, так что сумма совпадает с размером представления
+    stats.documents.bytes += bytes_.size() - inverted_index_bytes - forward_index_bytes - text_bytes;
+    if (is_external_) {
+        stats.mapped_bytes += bytes_.size();
+    }
+}
+
+IndexSegment IndexSegment::CollectDocuments(const std::vector<const IndexSegment*>& segments) {
+    IndexSegment merged;
+    size_t document_count = 0;
+    for (const IndexSegment* segment : segments) {
+        document_count += segment->GetDocumentCount();
+    }
+    merged.builder_->infos.Reserve(document_count);
+
+    for (const IndexSegment* segment : segments) {
+        for (DocumentOrdinal ordinal = 0; ordinal < segment->GetOrdinalCount(); ++ordinal) {
+            if (!segment->IsDeleted(ordinal)) {
+                merged.AppendDocument(segment->GetDocumentInfo(ordinal), segment->GetText(ordinal), segment->GetWordFreqs(ordinal));
+            }
+        }
+    }
+    return merged;
+}
+
+IndexSegment::Builder::Builder() {
+    forward_offsets.PushBack(0);
+}
+
+void IndexSegment::Builder::Append(const DocumentInfo& info, std::string_view text, WordFreqsView word_freqs) {
+    const auto ordinal = static_cast<DocumentOrdinal>(infos.size());
+    forward_term_ids.Append(word_freqs.term_ids);
+    forward_freqs.Append(word_freqs.term_freqs);
+    forward_offsets.PushBack(forward_term_ids.size());
+    texts.PushBack(text_arena.Append(text));
+
+    if (!word_freqs.term_ids.empty()) {
+        // Термы документа упорядочены, поэтому последний из них - наибольший
+        const TermId max_term_id = word_freqs.term_ids.back();
+        while (max_term_id >= postings.size()) {
+            word_to_document_freqs.PushBack(&postings.emplace_back());
+        }
+    }
+    // Номера документов растут, поэтому вхождения всегда дописываются в конец списков
+    for (size_t i = 0; i < word_freqs.term_ids.size(); ++i) {
+        postings[word_freqs.term_ids[i]].Append(ordinal, word_freqs.term_freqs[i]);
+    }
+    // Удаленный документ с тем же id мог остаться в сегменте до слияния
+    document_ordinals.InsertOrAssign(info.id, ordinal);
+    infos.PushBack(info);
+}
+
+IndexSegment::Builder& IndexSegment::ClaimBuilder() {
+    assert(builder_);
+    size_t ordinal_count = GetOrdinalCount();
+    if (!builder_->ordinal_count.compare_exchange_strong(ordinal_count, GetOrdinalCount() + 1)) {
+        // Другая копия уже дописывает builder_ после общих документов. Удаленные документы
+        // тоже переносятся, чтобы номера документов не изменились
+        auto builder = std::make_shared<Builder>();
+        builder->infos.Reserve(GetOrdinalCount() + 1);
+        for (DocumentOrdinal ordinal = 0; ordinal < GetOrdinalCount(); ++ordinal) {
+            builder->Append(infos_[ordinal], texts_[ordinal], GetWordFreqs(ordinal));
+        }
+        builder->ordinal_count.store(GetOrdinalCount() + 1, std::memory_order_relaxed);
+        builder_ = std::move(builder);
+        UpdateViews();
+    }
+    return *builder_;
+}
+
+void IndexSegment::UpdateViews() {
+    infos_ = builder_->infos.View();
+    forward_offsets_ = builder_->forward_offsets.View();
+    forward_term_ids_ = builder_->forward_term_ids.View();
+    forward_freqs_ = builder_->forward_freqs.View();
+    texts_ = builder_->texts.View();
+    word_to_document_freqs_ = builder_->word_to_document_freqs.View();
+}
+
+DocumentOrdinal IndexSegment::AppendDocument(const DocumentInfo& info, std::string_view text, WordFreqsView word_freqs) {
+    const auto ordinal = static_cast<DocumentOrdinal>(GetOrdinalCount());
+    ClaimBuilder().Append(info, text, word_freqs);
+    deleted_.Resize(ordinal + 1);
+    UpdateViews();
+    return ordinal;
+}
+
+void IndexSegment::AppendDocumentViews(std::vector<DocumentView>& documents, bool skip_deleted) const {
+    // Данные читаются через виды этой копии сегмента: другая копия может дописывать builder_ одновременно
+    for (DocumentOrdinal ordinal = 0; ordinal < GetOrdinalCount(); ++ordinal) {
+        if (!skip_deleted || !IsDeleted(ordinal)) {
+            documents.push_back({infos_[ordinal], GetText(ordinal), GetWordFreqs(ordinal)});
+        }
+    }
+}
+
+void IndexSegment::ReadBytes(ArrayView<char> bytes) {
+    BinaryReader reader(bytes.data(), bytes.size());
+    const auto ordinal_count = reader.Read<uint64_t>();
+    const auto term_count = reader.Read<uint64_t>();
+    const auto posting_count = reader.Read<uint64_t>();
+    const auto block_count = reader.Read<uint64_t>();
+    const auto forward_count = reader.Read<uint64_t>();
+    const auto text_size = reader.Read<uint64_t>();
+    const auto entry_count = reader.Read<uint64_t>();
+    if (ordinal_count >= std::numeric_limits<DocumentOrdinal>::max() || term_count >= std::numeric_limits<TermId>::max()) {
+        throw std::invalid_argument("Двоичные данные сегмента повреждены: слишком много документов или термов");
+    }
+    infos_ = reader.ReadArray<DocumentInfo>(ordinal_count);
+    forward_offsets_ = reader.ReadArray<uint64_t>(ordinal_count + 1);
+    forward_term_ids_ = reader.ReadArray<TermId>(forward_count);
+    forward_freqs_ = reader.ReadArray<double>(forward_count);
+    text_offsets_ = reader.ReadArray<uint64_t>(ordinal_count + 1);
+    text_ = reader.ReadArray<char>(text_size);
+    posting_offsets_ = reader.ReadArray<uint64_t>(term_count + 1);
+    posting_ordinals_ = reader.ReadArray<DocumentOrdinal>(posting_count);
+    posting_freqs_ = reader.ReadArray<double>(posting_count);
+    block_offsets_ = reader.ReadArray<uint64_t>(term_count + 1);
+    block_last_ordinals_ = reader.ReadArray<DocumentOrdinal>(block_count);
+    document_entries_ = reader.ReadArray<DocumentEntry>(entry_count);
+    reader.Align();
+    if (!reader.AtEnd()) {
+        throw std::invalid_argument("Двоичные данные сегмента повреждены: лишние данные в конце");
+    }
+    // Границы массивов проверяются один раз здесь, чтобы чтение на месте не выходило за пределы данных.
+    // Содержимое массивов проверяет CheckContents: данным, построенным в памяти, проверка не нужна
+    const auto is_valid_offsets = [](ArrayView<uint64_t> offsets, uint64_t total) {
+        return offsets.front() == 0 && offsets.back() == total && std::is_sorted(offsets.begin(), offsets.end());
+    };
+    if (!is_valid_offsets(forward_offsets_, forward_count) || !is_valid_offsets(text_offsets_, text_size)
+        || !is_valid_offsets(posting_offsets_, posting_count) || !is_valid_offsets(block_offsets_, block_count)) {
+        throw std::invalid_argument("Двоичные данные сегмента повреждены: неверные границы массивов");
+    }
+    bytes_ = bytes;
+}
+
+void IndexSegment::CheckContents(size_t term_count) const {
+    // Массивы читаются один раз при открытии, зато запросы к поврежденному или чужому файлу
+    // получают исключение здесь, а не чтение за пределами массивов
+    const size_t ordinal_count = GetOrdinalCount();
+    const auto is_valid_ordinal = [ordinal_count](DocumentOrdinal ordinal) {
+        return ordinal < ordinal_count;
+    };
+    if (!std::all_of(posting_ordinals_.begin(), posting_ordinals_.end(), is_valid_ordinal)
+        || !std::all_of(block_last_ordinals_.begin(), block_last_ordinals_.end(), is_valid_ordinal)
+        || !std::all_of(document_entries_.begin(), document_entries_.end(), [&](const DocumentEntry& entry) {
+               return is_valid_ordinal(entry.ordinal);
+           })) {
+        throw std::invalid_argument("Двоичные данные сегмента повреждены: номер документа вне сегмента");
+    }
+    if (!std::all_of(forward_term_ids_.begin(), forward_term_ids_.end(), [term_count](TermId term_id) {
+            return term_id < term_count;
+        })) {
+        throw std::invalid_argument("Двоичные данные сегмента повреждены: id терма вне словаря");
+    }
+    if (!std::all_of(infos_.begin(), infos_.end(), [](const DocumentInfo& info) {
+            const auto status = static_cast<std::underlying_type_t<DocumentStatus>>(info.status);
+            return status >= 0 && status <= static_cast<std::underlying_type_t<DocumentStatus>>(DocumentStatus::REMOVED);
+        })) {
+        throw std::invalid_argument("Двоичные данные сегмента повреждены: неизвестный статус документа");
+    }
+}
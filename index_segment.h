@@ -0,0 +1,218 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "append_only_array.h"
+#include "array_view.h"
+#include "bitmap.h"
+#include "document.h"
+#include "document_ordinal_table.h"
+#include "memory_tracking.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+#include "text_arena.h"
+
+// Данные добавляемого в сегмент документа
+struct DocumentData {
+    int id = -1;        // Внешний id документа
+    int rating = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::string_view text;  // Исходный текст документа, сегмент хранит его копию. Может быть пустым
+    std::map<TermId, double> word_freqs;
+};
+
+// Поля документа, по которым фильтруются результаты поиска. Хранятся в сегменте массивом,
+// который читается на месте, в том числе из отображенного в память файла индекса
+struct DocumentInfo {
+    int32_t id;
+    int32_t rating;
+    DocumentStatus status;
+};
+
+// Частоты термов документа: id термов по возрастанию и соответствующие им частоты
+struct WordFreqsView {
+    ArrayView<TermId> term_ids;
+    ArrayView<double> term_freqs;
+};
+
+// Документ, из которого строится запечатанный сегмент (см. IndexSegment::Build). Данные не копируются
+struct DocumentView {
+    DocumentInfo info;
+    std::string_view text;
+    WordFreqsView word_freqs;
+};
+
+// Сегмент индекса: часть документов сервера вместе со списками вхождений по ним.
+// Номера документов внутри сегмента локальные и плотные: от 0 до GetOrdinalCount().
+// Пока сегмент пишется, в него добавляются документы; запечатывание (Seal) переводит сегмент
+// в компактное двоичное представление из непрерывных массивов, которое больше не меняется
+// и может читаться из нескольких потоков. То же представление сохраняется в файл индекса
+// и читается из отображенного в память файла без разбора.
+// Удаление только отмечает документ в карте удаленных (tombstone), а вхождения
+// вычищаются позже слиянием. Копии сегмента разделяют документы, списки вхождений и куски
+// карты удаленных: копирование стоит O(число кусков карты), а отметка в копии копирует один кусок.
+// Незапечатанный сегмент только дописывается: каждая копия видит документы с номерами меньше
+// своего GetOrdinalCount(), поэтому добавление документа после публикации снимка индекса
+// не копирует данные, которые читает снимок
+class IndexSegment {
+public:
+    IndexSegment();
+
+    // Запечатанный сегмент из двоичного представления bytes (см. GetBytes). Данные не копируются,
+    // storage владеет памятью bytes. id термов сегмента должны быть меньше term_count - числа термов словаря.
+    // При ошибке в данных выбрасывается std::invalid_argument
+    static IndexSegment Open(std::shared_ptr<const void> storage, ArrayView<char> bytes, size_t term_count);
+
+    // Добавление документа в незапечатанный сегмент, возвращает его номер в сегменте
+    DocumentOrdinal AddDocument(DocumentData document);
+
+    // Добавление документа, термы которого уже упорядочены по id
+    DocumentOrdinal AddDocument(const DocumentView& document);
+
+    // Отметка документа удаленным. Списки вхождений не меняются
+    void RemoveDocument(DocumentOrdinal ordinal);
+
+    // Номер неудаленного документа по внешнему id
+    [[nodiscard]] std::optional<DocumentOrdinal> FindDocument(int document_id) const;
+
+    [[nodiscard]] bool IsDeleted(DocumentOrdinal ordinal) const {
+        return deleted_.Test(ordinal);
+    }
+
+    [[nodiscard]] const DocumentInfo& GetDocumentInfo(DocumentOrdinal ordinal) const {
+        return infos_[ordinal];
+    }
+
+    [[nodiscard]] WordFreqsView GetWordFreqs(DocumentOrdinal ordinal) const;
+
+    [[nodiscard]] std::string_view GetText(DocumentOrdinal ordinal) const;
+
+    // Список вхождений терма. Для термов, которых нет в сегменте, возвращается пустой список.
+    // Список может содержать удаленные документы
+    [[nodiscard]] PostingListView GetPostings(TermId term_id) const;
+
+    // Количество неудаленных документов в сегменте
+    [[nodiscard]] size_t GetDocumentCount() const;
+
+    // Количество удаленных документов, вхождения которых еще не вычищены
+    [[nodiscard]] size_t GetDeletedCount() const;
+
+    // Верхняя граница номеров документов сегмента
+    [[nodiscard]] size_t GetOrdinalCount() const;
+
+    // Верхняя граница id термов, у которых в сегменте есть список вхождений
+    [[nodiscard]] size_t GetTermCount() const;
+
+    // Сегменты - копии друг друга (разделяют документы и списки вхождений)
+    [[nodiscard]] bool SharesData(const IndexSegment& other) const;
+
+    [[nodiscard]] bool IsSealed() const;
+
+    // Перевод сегмента в неизменяемое двоичное представление. Отметки об удалении сохраняются
+    void Seal();
+
+    // Двоичное представление запечатанного сегмента. Отметки об удалении в него не входят
+    [[nodiscard]] ArrayView<char> GetBytes() const;
+
+    // Запечатанный сегмент из документов, номера назначаются по порядку. Массивы двоичного представления
+    // заполняются сразу: списки вхождений строятся подсчетом по прямому индексу, без промежуточных списков
+    static IndexSegment Build(const std::vector<DocumentView>& documents);
+
+    // Слияние сегментов в новый запечатанный сегмент. Удаленные документы отбрасываются,
+    // номера назначаются заново в порядке следования сегментов
+    static IndexSegment Merge(const std::vector<std::shared_ptr<const IndexSegment>>& segments);
+
+    // Незапечатанная копия сегмента без удаленных документов. В нее можно продолжать добавлять документы
+    [[nodiscard]] IndexSegment Compact() const;
+
+    // Учет памяти сегмента в статистике по структурам индекса
+    void AddMemoryUsage(MemoryStats& stats) const;
+
+private:
+    // Данные незапечатанного сегмента. Массивы документов только дописываются,
+    // поэтому уже имеют то же устройство, что и в двоичном представлении.
+    // Дописывает одна копия сегмента - та, что первой заняла следующий номер документа;
+    // остальные копии читают данные одновременно с ней, каждая до своей границы
+    struct Builder {
+        Builder();
+
+        // Добавление документа, номер которого уже занят в ordinal_count
+        void Append(const DocumentInfo& info, std::string_view text, WordFreqsView word_freqs);
+
+        std::atomic<size_t> ordinal_count = 0;          // Занятые номера документов
+        AppendOnlyArray<DocumentInfo> infos;            // Индексируется номером документа
+        AppendOnlyArray<uint64_t> forward_offsets;      // Границы термов документа в forward_term_ids
+        AppendOnlyArray<TermId> forward_term_ids;
+        AppendOnlyArray<double> forward_freqs;
+        TextArena text_arena;
+        AppendOnlyArray<std::string_view> texts;        // Указывают в text_arena
+        std::deque<AppendOnlyPostingList> postings;     // Индексируется id терма
+        AppendOnlyArray<const AppendOnlyPostingList*> word_to_document_freqs;  // Указывают в postings
+        DocumentOrdinalTable document_ordinals;
+    };
+
+    // Элемент отсортированной по id таблицы документов запечатанного сегмента
+    struct DocumentEntry {
+        int32_t id;
+        DocumentOrdinal ordinal;
+    };
+
+    std::shared_ptr<Builder> builder_;          // Есть только у незапечатанного сегмента
+    std::shared_ptr<const void> storage_;       // Владелец двоичного представления запечатанного сегмента
+    ArrayView<char> bytes_;
+    bool is_external_ = false;                  // Двоичное представление передано в Open, например из файла
+
+    // Массивы документов. Указывают в builder_ или в двоичное представление
+    ArrayView<DocumentInfo> infos_;
+    ArrayView<uint64_t> forward_offsets_;
+    ArrayView<TermId> forward_term_ids_;
+    ArrayView<double> forward_freqs_;
+    // Тексты и списки вхождений незапечатанного сегмента
+    ArrayView<std::string_view> texts_;
+    ArrayView<const AppendOnlyPostingList*> word_to_document_freqs_;
+    // Тексты запечатанного сегмента: все тексты подряд и их границы
+    ArrayView<uint64_t> text_offsets_;
+    ArrayView<char> text_;
+
+    // Списки вхождений запечатанного сегмента: вхождения всех термов подряд,
+    // границы списка терма - в posting_offsets_, границы его указателей пропуска - в block_offsets_
+    ArrayView<uint64_t> posting_offsets_;
+    ArrayView<DocumentOrdinal> posting_ordinals_;
+    ArrayView<double> posting_freqs_;
+    ArrayView<uint64_t> block_offsets_;
+    ArrayView<DocumentOrdinal> block_last_ordinals_;
+    ArrayView<DocumentEntry> document_entries_;     // По возрастанию id
+
+    ChunkedBitmap deleted_;     // Куски разделяются с копиями сегмента
+    size_t deleted_count_ = 0;
+
+    // Данные для добавления документа: занимает следующий номер в builder_. Если его уже заняла
+    // другая копия сегмента, документы этой копии сначала дописываются в новый builder_
+    Builder& ClaimBuilder();
+
+    // Перенаправление массивов документов на данные builder_
+    void UpdateViews();
+
+    DocumentOrdinal AppendDocument(const DocumentInfo& info, std::string_view text, WordFreqsView word_freqs);
+
+    // Незапечатанный сегмент из неудаленных документов сегментов
+    static IndexSegment CollectDocuments(const std::vector<const IndexSegment*>& segments);
+
+    // Добавление документов сегмента в documents. Удаленные документы пропускаются, если skip_deleted
+    void AppendDocumentViews(std::vector<DocumentView>& documents, bool skip_deleted) const;
+
+    // Разбор двоичного представления в массивы сегмента
+    void ReadBytes(ArrayView<char> bytes);
+
+    // Проверка содержимого массивов, прочитанных из внешних данных: номера документов, id термов
+    // и статусы не выходят за допустимые границы. При ошибке выбрасывается std::invalid_argument
+    void CheckContents(size_t term_count) const;
+};
@@ -0,0 +1,338 @@
+#include "index_snapshot.h"
+
+#include "string_processing.h"
+
+using namespace std::literals;
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+IndexSnapshot::IndexSnapshot(std::shared_ptr<const StopWordSet> stop_words,
+                             std::shared_ptr<const TermDictionary> term_dictionary,
+                             std::vector<std::shared_ptr<const IndexSegment>> segments,
+                             std::shared_ptr<const InverseDocumentFreqs> inverse_document_freqs,
+                             size_t document_count,
+                             uint64_t generation,
+                             std::shared_ptr<ResultCache> result_cache)
+        : stop_words_(std::move(stop_words))
+        , term_dictionary_(std::move(term_dictionary))
+        , segments_(std::move(segments))
+        , inverse_document_freqs_(std::move(inverse_document_freqs))
+        , document_count_(document_count)
+        , generation_(generation)
+        , result_cache_(std::move(result_cache)) {
+}
+
+// Поиск наиболее релевантных документов по статусу
+vector<Document> IndexSnapshot::FindTopDocuments(string_view raw_query, DocumentStatus status, const SearchOptions& options) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status, options);
+}
+
+// Поиск наиболее релевантных документов по статусу. Последовательная версия
+[[nodiscard]] std::vector<Document>
+IndexSnapshot::FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentStatus status, const SearchOptions& options) const {
+    return FindTopDocumentsWithStatus(std::execution::seq, ParseQuery(raw_query), status, options);
+}
+
+// Поиск наиболее релевантных документов по статусу. Параллельная версия
+[[nodiscard]] std::vector<Document>
+IndexSnapshot::FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentStatus status, const SearchOptions& options) const {
+    return FindTopDocumentsWithStatus(std::execution::par, ParseQuery(raw_query), status, options);
+}
+
+PreparedQuery IndexSnapshot::Prepare(string_view raw_query) const {
+    return {raw_query, ParseQuery(raw_query), term_dictionary_, inverse_document_freqs_};
+}
+
+// Поиск по подготовленному запросу по статусу
+vector<Document> IndexSnapshot::FindTopDocuments(const PreparedQuery& query, DocumentStatus status, const SearchOptions& options) const {
+    return FindTopDocuments(std::execution::seq, query, status, options);
+}
+
+// Поиск по подготовленному запросу по статусу. Последовательная версия
+vector<Document> IndexSnapshot::FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, DocumentStatus status,
+                                                 const SearchOptions& options) const {
+    Query reparsed;
+    return FindTopDocumentsWithStatus(std::execution::seq, ResolveQuery(query, reparsed), status, options);
+}
+
+// Поиск по подготовленному запросу по статусу. Параллельная версия
+vector<Document> IndexSnapshot::FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, DocumentStatus status,
+                                                 const SearchOptions& options) const {
+    Query reparsed;
+    return FindTopDocumentsWithStatus(std::execution::par, ResolveQuery(query, reparsed), status, options);
+}
+
+// Возвращает количество документов в снимке
+int IndexSnapshot::GetDocumentCount() const {
+    return static_cast<int>(document_count_);
+}
+
+// Метод получения частот слов по id документа
+WordFrequencies IndexSnapshot::GetWordFrequencies(int document_id) const {
+    // Вид держит сам сегмент, а не снимок, поэтому сегмент ищется здесь, а не через FindDocumentLocation
+    for (const auto& segment : segments_) {
+        if (const auto ordinal = segment->FindDocument(document_id)) {
+            return {segment, term_dictionary_, segment->GetWordFreqs(*ordinal)};
+        }
+    }
+    return {};
+}
+
+// Возвращает все слова из поискового запроса, присутствующие в документе.
+[[nodiscard]] IndexSnapshot::MatchDocumentResult IndexSnapshot::MatchDocument(string_view raw_query, int document_id) const {
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+// Возвращает все слова из поискового запроса, присутствующие в документе.
+// Последовательная версия
+[[nodiscard]] IndexSnapshot::MatchDocumentResult IndexSnapshot::MatchDocument(const std::execution::sequenced_policy&, string_view raw_query, int document_id) const {
+    return MatchDocumentForQuery(std::execution::seq, ParseQuery(raw_query), document_id);
+}
+
+// Возвращает все слова из поискового запроса, присутствующие в документе.
+// Параллельная версия
+[[nodiscard]] IndexSnapshot::MatchDocumentResult IndexSnapshot::MatchDocument(const std::execution::parallel_policy&, string_view raw_query, int document_id) const {
+    return MatchDocumentForQuery(std::execution::par, ParseQuery(raw_query), document_id);
+}
+
+// Слова подготовленного запроса, присутствующие в документе
+IndexSnapshot::MatchDocumentResult IndexSnapshot::MatchDocument(const PreparedQuery& query, int document_id) const {
+    return MatchDocument(std::execution::seq, query, document_id);
+}
+
+// Слова подготовленного запроса, присутствующие в документе. Последовательная версия
+IndexSnapshot::MatchDocumentResult IndexSnapshot::MatchDocument(const std::execution::sequenced_policy&, const PreparedQuery& query, int document_id) const {
+    Query reparsed;
+    return MatchDocumentForQuery(std::execution::seq, ResolveQuery(query, reparsed), document_id);
+}
+
+// Слова подготовленного запроса, присутствующие в документе. Параллельная версия
+IndexSnapshot::MatchDocumentResult IndexSnapshot::MatchDocument(const std::execution::parallel_policy&, const PreparedQuery& query, int document_id) const {
+    Query reparsed;
+    return MatchDocumentForQuery(std::execution::par, ResolveQuery(query, reparsed), document_id);
+}
+
+IndexSnapshot::MatchDocumentResult IndexSnapshot::MatchDocumentForQuery(const std::execution::sequenced_policy&, const Query& query, int document_id) const {
+    return MatchDocumentAt(query, GetDocumentLocation(document_id));
+}
+
+IndexSnapshot::MatchDocumentResult IndexSnapshot::MatchDocumentForQuery(const std::execution::parallel_policy&, const Query& query, int document_id) const {
+    const DocumentLocation location = GetDocumentLocation(document_id);
+    const DocumentStatus status = location.segment->GetDocumentInfo(location.ordinal).status;
+
+    const auto word_checker = [&location](TermId term_id) {
+        return location.segment->GetPostings(term_id).Contains(location.ordinal);
+    };
+
+    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), word_checker)) {
+        return { vector<string_view>{}, status };
+    }
+
+    QueryTermIds matched_words;
+    matched_words.resize(query.plus_words.size());
+    const auto matched_end = std::copy_if(
+        std::execution::par,
+        query.plus_words.begin(), query.plus_words.end(),
+        matched_words.begin(),
+        word_checker
+    );
+    matched_words.erase(matched_end, matched_words.end());
+
+    return { GetSortedWords(matched_words), status };
+}
+
+// Слова запроса, присутствующие в каждом из документов
+vector<IndexSnapshot::MatchDocumentResult> IndexSnapshot::MatchDocuments(string_view raw_query, const vector<int>& document_ids) const {
+    return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+// Слова запроса, присутствующие в каждом из документов. Последовательная версия
+vector<IndexSnapshot::MatchDocumentResult> IndexSnapshot::MatchDocuments(const std::execution::sequenced_policy&, string_view raw_query,
+                                                                         const vector<int>& document_ids) const {
+    return MatchDocumentsForQuery(std::execution::seq, ParseQuery(raw_query), document_ids);
+}
+
+// Слова запроса, присутствующие в каждом из документов. Параллельная версия
+vector<IndexSnapshot::MatchDocumentResult> IndexSnapshot::MatchDocuments(const std::execution::parallel_policy&, string_view raw_query,
+                                                                         const vector<int>& document_ids) const {
+    return MatchDocumentsForQuery(std::execution::par, ParseQuery(raw_query), document_ids);
+}
+
+// Слова подготовленного запроса, присутствующие в каждом из документов
+vector<IndexSnapshot::MatchDocumentResult> IndexSnapshot::MatchDocuments(const PreparedQuery& query, const vector<int>& document_ids) const {
+    return MatchDocuments(std::execution::seq, query, document_ids);
+}
+
+// Слова подготовленного запроса, присутствующие в каждом из документов. Последовательная версия
+vector<IndexSnapshot::MatchDocumentResult> IndexSnapshot::MatchDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query,
+                                                                         const vector<int>& document_ids) const {
+    Query reparsed;
+    return MatchDocumentsForQuery(std::execution::seq, ResolveQuery(query, reparsed), document_ids);
+}
+
+// Слова подготовленного запроса, присутствующие в каждом из документов. Параллельная версия
+vector<IndexSnapshot::MatchDocumentResult> IndexSnapshot::MatchDocuments(const std::execution::parallel_policy&, const PreparedQuery& query,
+                                                                         const vector<int>& document_ids) const {
+    Query reparsed;
+    return MatchDocumentsForQuery(std::execution::par, ResolveQuery(query, reparsed), document_ids);
+}
+
+vector<IndexSnapshot::MatchDocumentResult> IndexSnapshot::MatchDocumentsForQuery(const std::execution::sequenced_policy&, const Query& query,
+                                                                                 const vector<int>& document_ids) const {
+    vector<MatchDocumentResult> results;
+    results.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        results.push_back(MatchDocumentAt(query, GetDocumentLocation(document_id)));
+    }
+    return results;
+}
+
+vector<IndexSnapshot::MatchDocumentResult> IndexSnapshot::MatchDocumentsForQuery(const std::execution::parallel_policy&, const Query& query,
+                                                                                 const vector<int>& document_ids) const {
+    // Документы ищутся заранее: исключение из параллельного алгоритма завершило бы программу.
+    // Параллельно обрабатываются документы, а не слова запроса: документов много, и каждый сопоставляется целиком
+    vector<DocumentLocation> locations;
+    locations.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        locations.push_back(GetDocumentLocation(document_id));
+    }
+    vector<MatchDocumentResult> results(locations.size());
+    std::transform(std::execution::par, locations.begin(), locations.end(), results.begin(), [this, &query](const DocumentLocation& location) {
+        return MatchDocumentAt(query, location);
+    });
+    return results;
+}
+
+IndexSnapshot::MatchDocumentResult IndexSnapshot::MatchDocumentAt(const Query& query, const DocumentLocation& location) const {
+    const auto [segment, ordinal] = location;
+    const DocumentStatus status = segment->GetDocumentInfo(ordinal).status;
+    const ArrayView<TermId> document_terms = segment->GetWordFreqs(ordinal).term_ids;
+    const size_t query_word_count = query.plus_words.size() + query.minus_words.size();
+    QueryTermIds matched_words;
+    if (document_terms.size() + query_word_count <= query_word_count * POSTING_PROBE_COST) {
+        // Термы документа и слова запроса отсортированы, поэтому пересекаются слиянием
+        QueryTermIds matched_minus_words;
+        std::set_intersection(document_terms.begin(), document_terms.end(), query.minus_words.begin(), query.minus_words.end(),
+                              std::back_inserter(matched_minus_words));
+        if (!matched_minus_words.empty()) {
+            return {vector<string_view>{}, status};
+        }
+        std::set_intersection(document_terms.begin(), document_terms.end(), query.plus_words.begin(), query.plus_words.end(),
+                              std::back_inserter(matched_words));
+        return {GetSortedWords(matched_words), status};
+    }
+    for (const TermId term_id : query.minus_words) {
+        if (segment->GetPostings(term_id).Contains(ordinal)) {
+            return {vector<string_view>{}, status};
+        }
+    }
+    for (const TermId term_id : query.plus_words) {
+        if (segment->GetPostings(term_id).Contains(ordinal)) {
+            matched_words.push_back(term_id);
+        }
+    }
+    return {GetSortedWords(matched_words), status};
+}
+
+// Проверка на стоп-слова
+bool IndexSnapshot::IsStopWord(string_view word) const {
+    return stop_words_->Contains(word);
+}
+
+IndexSnapshot::QueryWord IndexSnapshot::ParseQueryWord(string_view text) const {
+    if (text.empty()) {
+        throw std::invalid_argument("В тексте запроса нет слов");
+    }
+    bool is_minus = false;
+    if (text[0] == '-') {
+        is_minus = true;
+        text.remove_prefix(1);
+    }
+    if (text.empty())
+        throw std::invalid_argument("Отсутствие текста после символа «минус»: в поисковом запросе");
+    if (text[0] == '-')
+        throw std::invalid_argument("Наличие более чем одного минуса перед словами, которых не должно быть в искомых документах");
+
+    return {text, is_minus, IsStopWord(text)};
+}
+
+IndexSnapshot::Query IndexSnapshot::ParseQuery(string_view text) const {
+    Query query;
+    // Спец-символы проверяются при разбиении сразу для всего запроса
+    thread_local vector<string_view> words;
+    if (!SplitIntoWords(text, words)) {
+        throw std::invalid_argument("Наличие недопустимых символов (с кодами от 0 до 31) в тексте запроса");
+    }
+    for (string_view word : words) {
+        const QueryWord query_word = ParseQueryWord(word);
+        if (query_word.is_stop) {
+            continue;
+        }
+        // Словарь общий для всех версий индекса. Термы, добавленные после публикации снимка,
+        // не встречаются в его документах
+        const auto term_id = term_dictionary_->Find(query_word.data);
+        if (!term_id || *term_id >= inverse_document_freqs_->size()) {
+            continue;
+        }
+        if (query_word.is_minus) {
+            query.minus_words.push_back(*term_id);
+        } else {
+            query.plus_words.push_back(*term_id);
+        }
+    }
+    for (QueryTermIds* words : {&query.plus_words, &query.minus_words}) {
+        std::sort(words->begin(), words->end());
+        words->erase(std::unique(words->begin(), words->end()), words->end());
+    }
+    query.plus_word_idfs.reserve(query.plus_words.size());
+    for (const TermId term_id : query.plus_words) {
+        query.plus_word_idfs.push_back((*inverse_document_freqs_)[term_id]);
+    }
+    return query;
+}
+
+const IndexSnapshot::Query& IndexSnapshot::ResolveQuery(const PreparedQuery& prepared, Query& reparsed) const {
+    // Id термов совпадают, только если словарь тот же, а IDF - если не изменилась статистика термов
+    if (prepared.term_dictionary_ == term_dictionary_ && prepared.inverse_document_freqs_ == inverse_document_freqs_) {
+        return prepared.query_;
+    }
+    reparsed = ParseQuery(prepared.text_);
+    return reparsed;
+}
+
+PreparedQuery::PreparedQuery(std::string_view text, IndexSnapshot::Query query, std::shared_ptr<const TermDictionary> term_dictionary,
+                             std::shared_ptr<const InverseDocumentFreqs> inverse_document_freqs)
+        : text_(text)
+        , query_(std::move(query))
+        , term_dictionary_(std::move(term_dictionary))
+        , inverse_document_freqs_(std::move(inverse_document_freqs)) {
+}
+
+vector<string_view> IndexSnapshot::GetSortedWords(const QueryTermIds& term_ids) const {
+    vector<string_view> words;
+    words.reserve(term_ids.size());
+    for (const TermId term_id : term_ids) {
+        words.push_back(term_dictionary_->GetTerm(term_id));
+    }
+    std::sort(words.begin(), words.end());
+    return words;
+}
+
+std::optional<IndexSnapshot::DocumentLocation> IndexSnapshot::FindDocumentLocation(int document_id) const {
+    for (const auto& segment : segments_) {
+        if (const auto ordinal = segment->FindDocument(document_id)) {
+            return DocumentLocation{segment.get(), *ordinal};
+        }
+    }
+    return std::nullopt;
+}
+
+IndexSnapshot::DocumentLocation IndexSnapshot::GetDocumentLocation(int document_id) const {
+    const auto location = FindDocumentLocation(document_id);
+    if (!location) {
+        throw std::out_of_range("Документ с id "s + std::to_string(document_id) + " не найден"s);
+    }
+    return *location;
+}
@@ -0,0 +1,550 @@
+#pragma once
+
+#include <algorithm>
+#include <execution>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "index_segment.h"
+#include "result_cache.h"
+#include "score_accumulator.h"
+#include "small_vector.h"
+#include "stop_word_set.h"
+#include "term_dictionary.h"
+#include "term_statistics.h"
+#include "top_documents_collector.h"
+#include "word_frequencies.h"
+
+constexpr int MAX_RESULT_DOCUMENT_COUNT = 5;
+
+// Параметры поиска. Неявно создается из top_k, поэтому можно передавать просто число документов
+struct SearchOptions {
+    SearchOptions(size_t top_k = MAX_RESULT_DOCUMENT_COUNT, ScoreAccumulatorType accumulator = ScoreAccumulatorType::DENSE)
+            : top_k(top_k)
+            , accumulator(accumulator) {
+    }
+
+    size_t top_k;                       // Сколько наиболее релевантных документов вернуть
+    ScoreAccumulatorType accumulator;   // Накопитель релевантности последовательного поиска
+};
+
+class PreparedQuery;
+
+// Неизменяемый снимок индекса: набор сегментов, таблица IDF и число документов на момент публикации.
+// Снимок держит сегменты по shared_ptr, поэтому изменения сервера после публикации в нем не видны,
+// а серия запросов к одному снимку получает согласованные результаты.
+// Методы снимка можно вызывать из нескольких потоков одновременно с изменением сервера.
+// Поиск по статусу берет результаты из кеша result_cache, если он задан. Поколение generation - версия содержимого
+// индекса, по которой построен снимок: результаты других версий из кеша не возвращаются. Поиск по предикату кеш не использует
+class IndexSnapshot {
+public:
+    IndexSnapshot(std::shared_ptr<const StopWordSet> stop_words,
+                  std::shared_ptr<const TermDictionary> term_dictionary,
+                  std::vector<std::shared_ptr<const IndexSegment>> segments,
+                  std::shared_ptr<const InverseDocumentFreqs> inverse_document_freqs,
+                  size_t document_count,
+                  uint64_t generation = 0,
+                  std::shared_ptr<ResultCache> result_cache = nullptr);
+
+    // Поиск наиболее релевантных документов по предикату
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                         const SearchOptions& options = {}) const;
+
+    // Поиск наиболее релевантных документов по статусу
+    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                         const SearchOptions& options = {}) const;
+
+    // Поиск наиболее релевантных документов по предикату. Последовательная версия
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                         const SearchOptions& options = {}) const;
+
+    // Поиск наиболее релевантных документов по статусу. Последовательная версия
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                         const SearchOptions& options = {}) const;
+
+    // Поиск наиболее релевантных документов по предикату. Параллельная версия
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                         const SearchOptions& options = {}) const;
+
+    // Поиск наиболее релевантных документов по статусу. Параллельная версия
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                         const SearchOptions& options = {}) const;
+
+    // Разбор запроса для многократного использования: слова переводятся в id термов,
+    // а IDF плюс-слов берутся из таблицы снимка. При ошибке в запросе выбрасывается std::invalid_argument
+    [[nodiscard]] PreparedQuery Prepare(std::string_view raw_query) const;
+
+    // Поиск по подготовленному запросу. Запрос не разбирается повторно, если он подготовлен
+    // по той же версии индекса (тот же словарь и та же таблица IDF), иначе разбирается по сохраненному тексту
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate,
+                                                         const SearchOptions& options = {}) const;
+
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                         const SearchOptions& options = {}) const;
+
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, DocumentPredicate document_predicate,
+                                                         const SearchOptions& options = {}) const;
+
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                         const SearchOptions& options = {}) const;
+
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, DocumentPredicate document_predicate,
+                                                         const SearchOptions& options = {}) const;
+
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                         const SearchOptions& options = {}) const;
+
+    // Возвращает количество документов в снимке
+    [[nodiscard]] int GetDocumentCount() const;
+
+    // Метод получения частот слов по id документа. Частоты не копируются, для отсутствующего документа вид пуст
+    [[nodiscard]] WordFrequencies GetWordFrequencies(int document_id) const;
+
+    using MatchDocumentResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
+
+    // Возвращеет все слова из поискового запроса, присутствующие в документе.
+    [[nodiscard]] MatchDocumentResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+    // Возвращеет все слова из поискового запроса, присутствующие в документе. Последовательная версия
+    [[nodiscard]] MatchDocumentResult MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const;
+
+    // Возвращеет все слова из поискового запроса, присутствующие в документе. Параллельная версия
+    [[nodiscard]] MatchDocumentResult MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const;
+
+    // Слова подготовленного запроса, присутствующие в документе
+    [[nodiscard]] MatchDocumentResult MatchDocument(const PreparedQuery& query, int document_id) const;
+
+    [[nodiscard]] MatchDocumentResult MatchDocument(const std::execution::sequenced_policy&, const PreparedQuery& query, int document_id) const;
+
+    [[nodiscard]] MatchDocumentResult MatchDocument(const std::execution::parallel_policy&, const PreparedQuery& query, int document_id) const;
+
+    // Слова запроса, присутствующие в каждом из документов document_ids, в порядке document_ids.
+    // Запрос разбирается один раз. Для каждого документа выбирается более дешевый способ: поиск документа
+    // в списках вхождений слов запроса или пересечение слов запроса с термами документа из прямого индекса.
+    // Если какого-то документа нет, выбрасывается std::out_of_range
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const;
+
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocuments(const std::execution::sequenced_policy&, std::string_view raw_query,
+                                                                  const std::vector<int>& document_ids) const;
+
+    // Параллельная версия: документы обрабатываются в нескольких потоках
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocuments(const std::execution::parallel_policy&, std::string_view raw_query,
+                                                                  const std::vector<int>& document_ids) const;
+
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocuments(const PreparedQuery& query, const std::vector<int>& document_ids) const;
+
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query,
+                                                                  const std::vector<int>& document_ids) const;
+
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocuments(const std::execution::parallel_policy&, const PreparedQuery& query,
+                                                                  const std::vector<int>& document_ids) const;
+
+private:
+    std::shared_ptr<const StopWordSet> stop_words_;
+    std::shared_ptr<const TermDictionary> term_dictionary_;
+    std::vector<std::shared_ptr<const IndexSegment>> segments_;
+    std::shared_ptr<const InverseDocumentFreqs> inverse_document_freqs_;    // Индексируется id терма
+    size_t document_count_;
+    uint64_t generation_;
+    std::shared_ptr<ResultCache> result_cache_;     // Общий для всех снимков сервера, может отсутствовать
+
+    // Проверка на стоп-слова
+    [[nodiscard]] bool IsStopWord(std::string_view word) const;
+
+    struct QueryWord {
+        std::string_view data;
+        bool is_minus{};
+        bool is_stop{};
+    };
+
+    [[nodiscard]] QueryWord ParseQueryWord(std::string_view text) const;
+
+    // Сколько слов запроса хранится без выделения памяти
+    static constexpr size_t INLINE_QUERY_WORD_COUNT = 16;
+    using QueryTermIds = SmallVector<TermId, INLINE_QUERY_WORD_COUNT>;
+
+    // Слова запроса в виде отсортированных id термов без повторов и IDF плюс-слов в том же порядке.
+    // Слова, которых нет в словаре, не встречаются ни в одном документе и в запрос не попадают.
+    // Запрос до INLINE_QUERY_WORD_COUNT плюс- и минус-слов разбирается без выделения памяти:
+    // слова текста пишутся в буфер потока, а id термов - во внутренние буферы запроса
+    struct Query {
+        QueryTermIds plus_words;
+        QueryTermIds minus_words;
+        SmallVector<double, INLINE_QUERY_WORD_COUNT> plus_word_idfs;
+    };
+
+    friend class PreparedQuery;
+
+    [[nodiscard]] Query ParseQuery(std::string_view text) const;
+
+    // Разобранный запрос для этого снимка: подготовленный, если он подготовлен по той же версии индекса,
+    // иначе разобранный заново в reparsed
+    [[nodiscard]] const Query& ResolveQuery(const PreparedQuery& prepared, Query& reparsed) const;
+
+    // Поиск документов со статусом status по разобранному запросу с кешем результатов.
+    // Результат не зависит от накопителя и политики выполнения, поэтому они в ключ кеша не входят
+    template <typename ExecutionPolicy>
+    [[nodiscard]] std::vector<Document> FindTopDocumentsWithStatus(ExecutionPolicy&& policy, const Query& query, DocumentStatus status,
+                                                                   const SearchOptions& options) const;
+
+    // Поиск top_k документов по разобранному запросу. Последовательная версия
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocumentsForQuery(const std::execution::sequenced_policy&, const Query& query,
+                                                                 DocumentPredicate document_predicate, const SearchOptions& options) const;
+
+    // Поиск top_k документов по разобранному запросу. Параллельная версия
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocumentsForQuery(const std::execution::parallel_policy&, const Query& query,
+                                                                 DocumentPredicate document_predicate, const SearchOptions& options) const;
+
+    [[nodiscard]] MatchDocumentResult MatchDocumentForQuery(const std::execution::sequenced_policy&, const Query& query, int document_id) const;
+
+    [[nodiscard]] MatchDocumentResult MatchDocumentForQuery(const std::execution::parallel_policy&, const Query& query, int document_id) const;
+
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocumentsForQuery(const std::execution::sequenced_policy&, const Query& query,
+                                                                          const std::vector<int>& document_ids) const;
+
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocumentsForQuery(const std::execution::parallel_policy&, const Query& query,
+                                                                          const std::vector<int>& document_ids) const;
+
+    // Во сколько раз поиск документа в списке вхождений по указателям пропуска дороже шага
+    // слияния отсортированных массивов. Используется для выбора способа сопоставления документа с запросом
+    static constexpr size_t POSTING_PROBE_COST = 8;
+
+    // Переводит id термов в слова, упорядоченные по алфавиту
+    [[nodiscard]] std::vector<std::string_view> GetSortedWords(const QueryTermIds& term_ids) const;
+
+    // Положение документа в снимке: сегмент и номер документа в нем
+    struct DocumentLocation {
+        const IndexSegment* segment;
+        DocumentOrdinal ordinal;
+    };
+
+    [[nodiscard]] std::optional<DocumentLocation> FindDocumentLocation(int document_id) const;
+
+    // Положение документа по внешнему id. Если документа нет, выбрасывается std::out_of_range
+    [[nodiscard]] DocumentLocation GetDocumentLocation(int document_id) const;
+
+    // Слова запроса, присутствующие в документе. Если термов документа немного по сравнению со словами запроса,
+    // термы документа из прямого индекса пересекаются со словами запроса, иначе документ ищется в списках вхождений
+    [[nodiscard]] MatchDocumentResult MatchDocumentAt(const Query& query, const DocumentLocation& location) const;
+
+    // Обход всех сегментов снимка
+    template <typename Function>
+    void ForEachSegment(Function function) const;
+
+    // Поиск по запросу с накоплением релевантности в std::map
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindAllDocumentsWithMap(const Query& query, DocumentPredicate document_predicate) const;
+
+    // Поиск top_k документов с накоплением релевантности в плотном массиве текущего потока.
+    // Сегменты обходятся по очереди, накопитель сбрасывается перед каждым сегментом.
+    // Документы сразу отбираются в кучу top_k, поэтому память выделяется только под результат
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocumentsWithDenseAccumulator(const Query& query, DocumentPredicate document_predicate,
+                                                                             size_t top_k) const;
+
+    // Подсчет релевантности документов сегмента с номерами из [range_begin, range_end) в накопитель.
+    // Сначала документы с минус-словами отмечаются в карте исключений накопителя,
+    // затем при подсчете плюс-слов они пропускаются вместе с удаленными документами сегмента.
+    // В накопитель попадают только подходящие документы
+    template <typename DocumentPredicate>
+    void ScoreDocumentRange(const IndexSegment& segment, const Query& query, DocumentPredicate document_predicate,
+                            DocumentOrdinal range_begin, DocumentOrdinal range_end, DenseScoreAccumulator& accumulator) const;
+
+    // Параллельный поиск top_k документов. Номера документов каждого сегмента делятся на диапазоны,
+    // каждая задача считает все слова запроса для своего диапазона и отбирает свои top_k документов,
+    // затем отобранные документы объединяются
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocumentsInRanges(const Query& query, DocumentPredicate document_predicate, size_t top_k) const;
+};
+
+// Подготовленный запрос (см. IndexSnapshot::Prepare и SearchServer::Prepare): id термов плюс- и минус-слов
+// и IDF плюс-слов. Запрос держит словарь и таблицу IDF версии индекса, по которой подготовлен, и хранит
+// исходный текст, чтобы разобрать запрос заново для другой версии индекса
+class PreparedQuery {
+public:
+    [[nodiscard]] const std::string& GetText() const {
+        return text_;
+    }
+
+private:
+    friend class IndexSnapshot;
+
+    PreparedQuery(std::string_view text, IndexSnapshot::Query query, std::shared_ptr<const TermDictionary> term_dictionary,
+                  std::shared_ptr<const InverseDocumentFreqs> inverse_document_freqs);
+
+    std::string text_;
+    IndexSnapshot::Query query_;
+    std::shared_ptr<const TermDictionary> term_dictionary_;
+    std::shared_ptr<const InverseDocumentFreqs> inverse_document_freqs_;
+};
+
+// Реализация шаблонных методов
+// Поиск наиболее релевантных документов по предикату
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document> IndexSnapshot::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                                    const SearchOptions& options) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate, options);
+}
+
+// Поиск наиболее релевантных документов по предикату. Последовательная версия
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document>
+IndexSnapshot::FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentPredicate document_predicate,
+                                const SearchOptions& options) const {
+    //LOG_DURATION_STREAM("Operation time", std::cout);
+    return FindTopDocumentsForQuery(std::execution::seq, ParseQuery(raw_query), document_predicate, options);
+}
+
+// Поиск наиболее релевантных документов по предикату. Параллельная версия
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document>
+IndexSnapshot::FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentPredicate document_predicate,
+                                const SearchOptions& options) const {
+    //LOG_DURATION_STREAM("Operation time", std::cout);
+    return FindTopDocumentsForQuery(std::execution::par, ParseQuery(raw_query), document_predicate, options);
+}
+
+// Поиск по подготовленному запросу
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document> IndexSnapshot::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate,
+                                                                    const SearchOptions& options) const {
+    return FindTopDocuments(std::execution::seq, query, document_predicate, options);
+}
+
+// Поиск по подготовленному запросу. Последовательная версия
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document>
+IndexSnapshot::FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, DocumentPredicate document_predicate,
+                                const SearchOptions& options) const {
+    Query reparsed;
+    return FindTopDocumentsForQuery(std::execution::seq, ResolveQuery(query, reparsed), document_predicate, options);
+}
+
+// Поиск по подготовленному запросу. Параллельная версия
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document>
+IndexSnapshot::FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, DocumentPredicate document_predicate,
+                                const SearchOptions& options) const {
+    Query reparsed;
+    return FindTopDocumentsForQuery(std::execution::par, ResolveQuery(query, reparsed), document_predicate, options);
+}
+
+// Поиск по статусу с кешем результатов
+template <typename ExecutionPolicy>
+[[nodiscard]] std::vector<Document>
+IndexSnapshot::FindTopDocumentsWithStatus(ExecutionPolicy&& policy, const Query& query, DocumentStatus status, const SearchOptions& options) const {
+    const auto status_predicate = [status]([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating) {
+        return document_status == status;
+    };
+    if (!result_cache_) {
+        return FindTopDocumentsForQuery(policy, query, status_predicate, options);
+    }
+    ResultCacheKey key;
+    for (const TermId term_id : query.plus_words) {
+        key.plus_words.push_back(term_id);
+    }
+    for (const TermId term_id : query.minus_words) {
+        key.minus_words.push_back(term_id);
+    }
+    key.status = status;
+    key.top_k = options.top_k;
+    if (auto documents = result_cache_->Find(key, generation_)) {
+        return std::move(*documents);
+    }
+    std::vector<Document> documents = FindTopDocumentsForQuery(policy, query, status_predicate, options);
+    result_cache_->Insert(key, generation_, documents);
+    return documents;
+}
+
+// Поиск top_k документов по разобранному запросу. Последовательная версия
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document>
+IndexSnapshot::FindTopDocumentsForQuery(const std::execution::sequenced_policy&, const Query& query, DocumentPredicate document_predicate,
+                                        const SearchOptions& options) const {
+    if (options.accumulator == ScoreAccumulatorType::MAP) {
+        // Полная сортировка не нужна: достаточно кучи из top_k лучших документов
+        return CollectTopDocuments(std::execution::seq, FindAllDocumentsWithMap(query, document_predicate), options.top_k);
+    }
+    return FindTopDocumentsWithDenseAccumulator(query, document_predicate, options.top_k);
+}
+
+// Поиск top_k документов по разобранному запросу. Параллельная версия
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document>
+IndexSnapshot::FindTopDocumentsForQuery(const std::execution::parallel_policy&, const Query& query, DocumentPredicate document_predicate,
+                                        const SearchOptions& options) const {
+    return FindTopDocumentsInRanges(query, document_predicate, options.top_k);
+}
+
+
+// Обход всех сегментов снимка
+template <typename Function>
+void IndexSnapshot::ForEachSegment(Function function) const {
+    for (const auto& segment : segments_) {
+        function(*segment);
+    }
+}
+
+// Поиск по запросу с накоплением релевантности в std::map
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document>
+IndexSnapshot::FindAllDocumentsWithMap(const Query& query, DocumentPredicate document_predicate) const {
+    std::vector<Document> matched_documents;
+    ForEachSegment([&](const IndexSegment& segment) {
+        std::map<DocumentOrdinal, double> document_to_relevance;
+        for (size_t word_index = 0; word_index < query.plus_words.size(); ++word_index) {
+            const PostingListView postings = segment.GetPostings(query.plus_words[word_index]);
+            if (postings.empty()) {
+                continue;
+            }
+            const double inverse_document_freq = query.plus_word_idfs[word_index];
+            const ArrayView<DocumentOrdinal> ordinals = postings.GetDocumentOrdinals();
+            const ArrayView<double> term_freqs = postings.GetTermFreqs();
+            for (size_t i = 0; i < ordinals.size(); ++i) {
+                if (segment.IsDeleted(ordinals[i])) {
+                    continue;
+                }
+                const DocumentInfo& document = segment.GetDocumentInfo(ordinals[i]);
+                if (document_predicate(document.id, document.status, document.rating)) {
+                    document_to_relevance[ordinals[i]] += term_freqs[i] * inverse_document_freq;
+                }
+            }
+        }
+
+        for (const TermId term_id : query.minus_words) {
+            for (const DocumentOrdinal ordinal : segment.GetPostings(term_id).GetDocumentOrdinals()) {
+                document_to_relevance.erase(ordinal);
+            }
+        }
+
+        for (const auto [ordinal, relevance] : document_to_relevance) {
+            const DocumentInfo& document = segment.GetDocumentInfo(ordinal);
+            matched_documents.emplace_back(document.id, relevance, document.rating);
+        }
+    });
+    return matched_documents;
+}
+
+// Поиск top_k документов с накоплением релевантности в плотном массиве текущего потока
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document>
+IndexSnapshot::FindTopDocumentsWithDenseAccumulator(const Query& query, DocumentPredicate document_predicate, size_t top_k) const {
+    DenseScoreAccumulator& accumulator = DenseScoreAccumulator::ForCurrentThread();
+    TopDocumentsCollector collector(top_k);
+    ForEachSegment([&](const IndexSegment& segment) {
+        const size_t ordinal_count = segment.GetOrdinalCount();
+        accumulator.Reset(0, static_cast<DocumentOrdinal>(ordinal_count));
+        ScoreDocumentRange(segment, query, document_predicate, 0, ordinal_count, accumulator);
+        collector.Reserve(accumulator.GetTouched().size());
+        for (const DocumentOrdinal ordinal : accumulator.GetTouched()) {
+            const DocumentInfo& document = segment.GetDocumentInfo(ordinal);
+            collector.Add({document.id, accumulator.GetScore(ordinal), document.rating});
+        }
+    });
+    return std::move(collector).Extract();
+}
+
+// Подсчет релевантности документов сегмента с номерами из [range_begin, range_end) в накопитель
+template <typename DocumentPredicate>
+void IndexSnapshot::ScoreDocumentRange(const IndexSegment& segment, const Query& query, DocumentPredicate document_predicate,
+                                       DocumentOrdinal range_begin, DocumentOrdinal range_end, DenseScoreAccumulator& accumulator) const {
+    for (const TermId term_id : query.minus_words) {
+        const PostingListView postings = segment.GetPostings(term_id);
+        const ArrayView<DocumentOrdinal> ordinals = postings.GetDocumentOrdinals();
+        for (size_t i = postings.Seek(range_begin); i < ordinals.size() && ordinals[i] < range_end; ++i) {
+            accumulator.Exclude(ordinals[i]);
+        }
+    }
+
+    for (size_t word_index = 0; word_index < query.plus_words.size(); ++word_index) {
+        const PostingListView postings = segment.GetPostings(query.plus_words[word_index]);
+        const double inverse_document_freq = query.plus_word_idfs[word_index];
+        const ArrayView<DocumentOrdinal> ordinals = postings.GetDocumentOrdinals();
+        const ArrayView<double> term_freqs = postings.GetTermFreqs();
+        // Начало диапазона находится по указателям пропуска
+        for (size_t i = postings.Seek(range_begin); i < ordinals.size() && ordinals[i] < range_end; ++i) {
+            if (accumulator.IsExcluded(ordinals[i]) || segment.IsDeleted(ordinals[i])) {
+                continue;
+            }
+            const DocumentInfo& document = segment.GetDocumentInfo(ordinals[i]);
+            if (document_predicate(document.id, document.status, document.rating)) {
+                accumulator.Add(ordinals[i], term_freqs[i] * inverse_document_freq);
+            }
+        }
+    }
+}
+
+// Параллельный поиск top_k документов по диапазонам номеров документов
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document>
+IndexSnapshot::FindTopDocumentsInRanges(const Query& query, DocumentPredicate document_predicate, size_t top_k) const {
+    // Диапазонов больше, чем потоков, чтобы нагрузка распределялась равномерно,
+    // но не меньше MIN_RANGE_SIZE документов, чтобы накладные расходы на задачу окупались
+    constexpr size_t MIN_RANGE_SIZE = 1024;
+    constexpr size_t RANGES_PER_THREAD = 4;
+    const size_t max_range_count = std::max(1u, std::thread::hardware_concurrency()) * RANGES_PER_THREAD;
+
+    // Задачи всех сегментов выполняются вместе, поэтому мелкие сегменты не простаивают в ожидании крупных
+    struct DocumentRange {
+        const IndexSegment* segment;
+        DocumentOrdinal begin;
+        DocumentOrdinal end;
+    };
+    std::vector<DocumentRange> ranges;
+    ForEachSegment([&](const IndexSegment& segment) {
+        const size_t ordinal_count = segment.GetOrdinalCount();
+        if (ordinal_count == 0) {
+            return;
+        }
+        const size_t range_count = std::clamp<size_t>(ordinal_count / MIN_RANGE_SIZE, 1, max_range_count);
+        for (size_t range = 0; range < range_count; ++range) {
+            ranges.push_back({&segment,
+                              static_cast<DocumentOrdinal>(ordinal_count * range / range_count),
+                              static_cast<DocumentOrdinal>(ordinal_count * (range + 1) / range_count)});
+        }
+    });
+
+    std::vector<TopDocumentsCollector> collectors(ranges.size(), TopDocumentsCollector(top_k));
+    std::vector<size_t> range_indexes(ranges.size());
+    std::iota(range_indexes.begin(), range_indexes.end(), 0);
+
+    std::for_each(
+        std::execution::par,
+        range_indexes.begin(), range_indexes.end(),
+        [&](size_t range_index) {
+            const DocumentRange& range = ranges[range_index];
+            // Каждая задача пишет только в свой накопитель и свою кучу, блокировки не нужны
+            const ScoreAccumulatorPool::Lease accumulator = ScoreAccumulatorPool::Instance().Acquire();
+            // Накопитель занимает память только под свой диапазон, а не под весь сегмент
+            accumulator->Reset(range.begin, range.end);
+            ScoreDocumentRange(*range.segment, query, document_predicate, range.begin, range.end, *accumulator);
+            collectors[range_index].Reserve(accumulator->GetTouched().size());
+            for (const DocumentOrdinal ordinal : accumulator->GetTouched()) {
+                const DocumentInfo& document = range.segment->GetDocumentInfo(ordinal);
+                collectors[range_index].Add({document.id, accumulator->GetScore(ordinal), document.rating});
+            }
+        });
+
+    TopDocumentsCollector result(top_k);
+    for (const TopDocumentsCollector& collector : collectors) {
+        result.Merge(collector);
+    }
+    return std::move(result).Extract();
+}
@@ -0,0 +1,86 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "corpus_ingestion.h"
+#include "log_duration.h"
+#include "search_server.h"
+
+using namespace std::literals;
+
+namespace {
+
+void PrintUsage(std::ostream& out) {
+    out << "Usage: ingest_corpus <corpus> [--threads N] [--batch-size N] [--queue N] [--stop-words \"w1 w2\"] [--drop-text] [--save <index>]\n"s
+        << "Each corpus line: id<TAB>status<TAB>ratings separated by spaces<TAB>text\n"s;
+}
+
+size_t ParseCount(const char* text) {
+    const long long value = std::stoll(text);
+    if (value <= 0) {
+        throw std::invalid_argument("Ожидалось положительное число: "s + text);
+    }
+    return static_cast<size_t>(value);
+}
+
+} // namespace
+
+// Потоковая загрузка корпуса из файла с выводом скорости загрузки.
+// Построенный индекс можно сохранить в файл для SearchServer::OpenSnapshot
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        PrintUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+    try {
+        const std::string corpus_path = argv[1];
+        IngestionOptions options;
+        std::string stop_words;
+        std::string index_path;
+        IndexOptions index_options;
+        for (int i = 2; i < argc; ++i) {
+            const std::string_view option = argv[i];
+            if (option == "--drop-text"sv) {
+                index_options.store_document_text = false;
+                continue;
+            }
+            if (i + 1 == argc) {
+                PrintUsage(std::cerr);
+                return EXIT_FAILURE;
+            }
+            const char* value = argv[++i];
+            if (option == "--threads"sv) {
+                options.thread_count = ParseCount(value);
+            } else if (option == "--batch-size"sv) {
+                options.batch_size = ParseCount(value);
+            } else if (option == "--queue"sv) {
+                options.max_pending_batches = ParseCount(value);
+            } else if (option == "--stop-words"sv) {
+                stop_words = value;
+            } else if (option == "--save"sv) {
+                index_path = value;
+            } else {
+                PrintUsage(std::cerr);
+                return EXIT_FAILURE;
+            }
+        }
+
+        SearchServer server(stop_words, index_options);
+        const IngestionStats stats = IngestCorpus(server, corpus_path, options, std::cout);
+        server.WaitForMerge();
+        std::cout << "Indexed "s << stats.document_count << " documents ("s << stats.byte_count << " bytes) in "s
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(stats.duration).count() << " ms, "s
+                  << static_cast<size_t>(stats.GetDocumentsPerSecond()) << " docs/s, "s
+                  << stats.rejected_line_count << " rejected lines"s << std::endl;
+        std::cout << server.GetMemoryStats();
+        if (!index_path.empty()) {
+            LOG_DURATION_STREAM("SaveSnapshot"s, std::cout);
+            server.SaveSnapshot(index_path);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: "s << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
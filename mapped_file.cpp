@@ -0,0 +1,47 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std::literals;
+
+std::shared_ptr<const MappedFile> MappedFile::Open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Не удалось открыть файл "s + path + ": "s + std::strerror(errno));
+    }
+    struct stat file_stat {};
+    if (::fstat(fd, &file_stat) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Не удалось получить размер файла "s + path + ": "s + std::strerror(error));
+    }
+    const auto size = static_cast<size_t>(file_stat.st_size);
+    if (size == 0) {
+        ::close(fd);
+        throw std::invalid_argument("Файл "s + path + " пуст"s);
+    }
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // Отображение остается действительным и после закрытия дескриптора
+    const int error = errno;
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Не удалось отобразить файл "s + path + " в память: "s + std::strerror(error));
+    }
+    return std::shared_ptr<const MappedFile>(new MappedFile(static_cast<const char*>(data), size));
+}
+
+MappedFile::MappedFile(const char* data, size_t size)
+        : data_(data)
+        , size_(size) {
+}
+
+MappedFile::~MappedFile() {
+    ::munmap(const_cast<char*>(data_), size_);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Файл, отображенный в память только для чтения. Отображение снимается при разрушении объекта,
+// поэтому все, кто читает данные файла, держат его по shared_ptr
+class MappedFile {
+public:
+    // Отображение файла. При ошибке открытия или отображения выбрасывается std::runtime_error
+    static std::shared_ptr<const MappedFile> Open(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    [[nodiscard]] const char* data() const {
+        return data_;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return size_;
+    }
+
+private:
+    MappedFile(const char* data, size_t size);
+
+    const char* data_;
+    size_t size_;
+};
@@ -0,0 +1,40 @@
+#include "memory_tracking.h"
+
+using namespace std::literals;
+
+size_t GetHeapBytes(const std::string& value) {
+    const auto* object_begin = reinterpret_cast<const char*>(&value);
+    const auto* object_end = object_begin + sizeof(value);
+    if (value.data() >= object_begin && value.data() < object_end) {
+        return 0;
+    }
+    // Строка выделяет место под завершающий ноль
+    return value.capacity() + 1;
+}
+
+MemoryUsage& MemoryUsage::operator+=(const MemoryUsage& other) {
+    bytes += other.bytes;
+    elements += other.elements;
+    return *this;
+}
+
+size_t MemoryStats::GetTotalBytes() const {
+    return inverted_index.bytes + forward_index.bytes + documents.bytes + document_texts.bytes
+         + document_ids.bytes + term_dictionary.bytes + term_statistics.bytes + stop_words.bytes;
+}
+
+std::ostream& operator<<(std::ostream& out, const MemoryStats& stats) {
+    const auto print = [&out](std::string_view name, const MemoryUsage& usage) {
+        out << "  "sv << name << ": "sv << usage.bytes << " bytes, "sv << usage.elements << " elements"sv << std::endl;
+    };
+    out << "Memory: "sv << stats.GetTotalBytes() << " bytes ("sv << stats.mapped_bytes << " mapped)"sv << std::endl;
+    print("inverted_index"sv, stats.inverted_index);
+    print("forward_index"sv, stats.forward_index);
+    print("documents"sv, stats.documents);
+    print("document_texts"sv, stats.document_texts);
+    print("document_ids"sv, stats.document_ids);
+    print("term_dictionary"sv, stats.term_dictionary);
+    print("term_statistics"sv, stats.term_statistics);
+    print("stop_words"sv, stats.stop_words);
+    return out;
+}
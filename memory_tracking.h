@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+// Распределитель памяти, который считает выделенные через него байты. Каждый контейнер
+// получает свой счетчик: копия контейнера заводит новый счетчик, а узлы и корзины,
+// которые контейнер выделяет через перепривязанный распределитель, учитываются в том же счетчике.
+// Так размер узловых контейнеров (std::set, std::unordered_map, std::deque) известен точно
+template <typename T>
+class TrackingAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    TrackingAllocator()
+            : allocated_bytes_(std::make_shared<std::atomic<size_t>>(0)) {
+    }
+
+    // Перемещение копирует счетчик: контейнер, из которого переместили данные, должен оставаться рабочим
+    TrackingAllocator(const TrackingAllocator&) noexcept = default;
+    TrackingAllocator& operator=(const TrackingAllocator&) noexcept = default;
+
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U>& other) noexcept  // NOLINT: перепривязка должна быть неявной
+            : allocated_bytes_(other.allocated_bytes_) {
+    }
+
+    T* allocate(size_t count) {
+        T* data = std::allocator<T>().allocate(count);
+        allocated_bytes_->fetch_add(count * sizeof(T), std::memory_order_relaxed);
+        return data;
+    }
+
+    void deallocate(T* data, size_t count) noexcept {
+        allocated_bytes_->fetch_sub(count * sizeof(T), std::memory_order_relaxed);
+        std::allocator<T>().deallocate(data, count);
+    }
+
+    // Копия контейнера считает свою память отдельно
+    [[nodiscard]] TrackingAllocator select_on_container_copy_construction() const {
+        return {};
+    }
+
+    // Байт, выделенных контейнером и еще не освобожденных
+    [[nodiscard]] size_t GetAllocatedBytes() const {
+        return allocated_bytes_->load(std::memory_order_relaxed);
+    }
+
+    template <typename U>
+    bool operator==(const TrackingAllocator<U>& other) const noexcept {
+        return allocated_bytes_ == other.allocated_bytes_;
+    }
+
+    template <typename U>
+    bool operator!=(const TrackingAllocator<U>& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    template <typename U>
+    friend class TrackingAllocator;
+
+    std::shared_ptr<std::atomic<size_t>> allocated_bytes_;
+};
+
+// Байт, которые строка занимает в куче. Короткие строки хранятся внутри объекта строки и кучу не занимают
+size_t GetHeapBytes(const std::string& value);
+
+// Память, занятая структурой индекса
+struct MemoryUsage {
+    size_t bytes = 0;
+    size_t elements = 0;
+
+    MemoryUsage& operator+=(const MemoryUsage& other);
+};
+
+// Память сервера по структурам индекса. Считается память текущей версии индекса:
+// сегменты, которые держат только снимки или фоновое слияние, не учитываются
+struct MemoryStats {
+    MemoryUsage inverted_index;     // Списки вхождений, элементы - вхождения
+    MemoryUsage forward_index;      // Частоты термов документов, элементы - пары (терм, частота)
+    MemoryUsage documents;          // Поля документов, таблицы id и отметки об удалении, элементы - документы сегментов
+    MemoryUsage document_texts;     // Исходные тексты документов, элементы - символы
+    MemoryUsage document_ids;       // Множество id документов сервера
+    MemoryUsage term_dictionary;    // Элементы - термы
+    MemoryUsage term_statistics;    // Документные частоты и таблица IDF, элементы - термы
+    MemoryUsage stop_words;
+    // Часть перечисленной памяти, которая читается из отображенного в память файла индекса.
+    // Эти страницы принадлежат файлу, а не куче, и могут вытесняться системой
+    size_t mapped_bytes = 0;
+
+    [[nodiscard]] size_t GetTotalBytes() const;
+};
+
+std::ostream& operator<<(std::ostream& out, const MemoryStats& stats);
@@ -0,0 +1,60 @@
+#include "posting_list.h"
+
+#include <algorithm>
+#include <iterator>
+
+void AppendOnlyPostingList::Append(DocumentOrdinal ordinal, double term_freq) {
+    // Частота публикуется раньше номера: читатель, увидевший номер, видит и ее
+    term_freqs_.PushBack(term_freq);
+    document_ordinals_.PushBack(ordinal);
+    if (document_ordinals_.size() % PostingListView::BLOCK_SIZE == 0) {
+        block_last_ordinals_.PushBack(ordinal);
+    }
+}
+
+PostingListView AppendOnlyPostingList::View(size_t ordinal_count) const {
+    ArrayView<DocumentOrdinal> document_ordinals = document_ordinals_.View();
+    // Вхождения документов, добавленных после границы читателя, лежат в конце списка
+    if (!document_ordinals.empty() && document_ordinals.back() >= ordinal_count) {
+        const auto end = std::lower_bound(document_ordinals.begin(), document_ordinals.end(), ordinal_count);
+        document_ordinals = document_ordinals.SubView(0, end - document_ordinals.begin());
+    }
+    const size_t count = document_ordinals.size();
+    const size_t block_count = std::min(count / PostingListView::BLOCK_SIZE, block_last_ordinals_.size());
+    return {document_ordinals, term_freqs_.View(count), block_last_ordinals_.View(block_count)};
+}
+
+size_t AppendOnlyPostingList::GetAllocatedBytes() const {
+    return document_ordinals_.GetAllocatedBytes() + term_freqs_.GetAllocatedBytes() + block_last_ordinals_.GetAllocatedBytes();
+}
+
+PostingListView::PostingListView(ArrayView<DocumentOrdinal> document_ordinals, ArrayView<double> term_freqs,
+                                 ArrayView<DocumentOrdinal> block_last_ordinals)
+        : document_ordinals_(document_ordinals)
+        , term_freqs_(term_freqs)
+        , block_last_ordinals_(block_last_ordinals) {
+}
+
+bool PostingListView::Contains(DocumentOrdinal ordinal) const {
+    const size_t position = Seek(ordinal);
+    return position < document_ordinals_.size() && document_ordinals_[position] == ordinal;
+}
+
+size_t PostingListView::Seek(DocumentOrdinal ordinal, size_t from) const {
+    if (from >= document_ordinals_.size()) {
+        return document_ordinals_.size();
+    }
+    // Сначала по указателям пропуска находим блок, затем ищем внутри него.
+    // Если указателя не нашлось, остается последний неполный блок, если у него нет указателя
+    const auto first_block = std::next(block_last_ordinals_.begin(), std::min(from / BLOCK_SIZE, block_last_ordinals_.size()));
+    const auto block = std::lower_bound(first_block, block_last_ordinals_.end(), ordinal);
+    const size_t block_begin = std::max(from, static_cast<size_t>(block - block_last_ordinals_.begin()) * BLOCK_SIZE);
+    if (block_begin >= document_ordinals_.size()) {
+        return document_ordinals_.size();
+    }
+    const size_t block_end = std::min(block_begin - block_begin % BLOCK_SIZE + BLOCK_SIZE, document_ordinals_.size());
+    const auto found = std::lower_bound(std::next(document_ordinals_.begin(), block_begin),
+                                        std::next(document_ordinals_.begin(), block_end),
+                                        ordinal);
+    return found - document_ordinals_.begin();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+
+#include "append_only_array.h"
+#include "array_view.h"
+#include "document.h"
+
+// Список вхождений терма (posting list) без владения памятью: отсортированные по возрастанию номера
+// документов и соответствующие им частоты терма. Массивы могут принадлежать AppendOnlyPostingList
+// или лежать в запечатанном сегменте, в том числе в отображенном в память файле индекса.
+// Для быстрого поиска по номеру есть указатели пропуска: последний номер каждого блока из BLOCK_SIZE вхождений.
+// У последнего неполного блока может не быть указателя пропуска, тогда он просматривается целиком
+class PostingListView {
+public:
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    PostingListView() = default;
+    PostingListView(ArrayView<DocumentOrdinal> document_ordinals, ArrayView<double> term_freqs,
+                    ArrayView<DocumentOrdinal> block_last_ordinals);
+
+    // Проверка наличия документа в списке
+    [[nodiscard]] bool Contains(DocumentOrdinal ordinal) const;
+
+    // Позиция первого вхождения с номером не меньше ordinal, поиск начинается с позиции from.
+    // Если такого вхождения нет, возвращается size()
+    [[nodiscard]] size_t Seek(DocumentOrdinal ordinal, size_t from = 0) const;
+
+    [[nodiscard]] size_t size() const {
+        return document_ordinals_.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return document_ordinals_.empty();
+    }
+
+    [[nodiscard]] ArrayView<DocumentOrdinal> GetDocumentOrdinals() const {
+        return document_ordinals_;
+    }
+
+    [[nodiscard]] ArrayView<double> GetTermFreqs() const {
+        return term_freqs_;
+    }
+
+    [[nodiscard]] ArrayView<DocumentOrdinal> GetBlockLastOrdinals() const {
+        return block_last_ordinals_;
+    }
+
+private:
+    ArrayView<DocumentOrdinal> document_ordinals_;
+    ArrayView<double> term_freqs_;
+    ArrayView<DocumentOrdinal> block_last_ordinals_;
+};
+
+// Список вхождений незапечатанного сегмента. Вхождения только дописываются в конец, и список можно читать
+// одновременно с добавлением: читатель видит вхождения документов с номерами меньше своей границы.
+// Указатель пропуска записывается, только когда блок заполнен, поэтому записанные данные не меняются
+class AppendOnlyPostingList {
+public:
+    // Добавление вхождения документа с номером больше всех номеров списка. Вызывается только писателем
+    void Append(DocumentOrdinal ordinal, double term_freq);
+
+    // Вхождения документов с номерами меньше ordinal_count
+    [[nodiscard]] PostingListView View(size_t ordinal_count) const;
+
+    [[nodiscard]] size_t GetAllocatedBytes() const;
+
+private:
+    AppendOnlyArray<DocumentOrdinal> document_ordinals_;
+    AppendOnlyArray<double> term_freqs_;
+    AppendOnlyArray<DocumentOrdinal> block_last_ordinals_;
+};
@@ -5,9 +5,11 @@ std::vector<std::vector<Document>> ProcessQueries(
         const SearchServer& search_server,
         const std::vector<std::string>& queries) {
     std::vector<std::vector<Document>> result(queries.size());
+    // Все запросы пакета выполняются на одной версии индекса
+    const auto snapshot = search_server.GetSnapshot();
     std::transform(std::execution::par, queries.begin(), queries.end(), result.begin(),
-                          [&search_server](const std::string& str) {
-                              return search_server.FindTopDocuments(str);
+                          [&snapshot](const std::string& str) {
+                              return snapshot->FindTopDocuments(str);
                           });
     return result;
 }
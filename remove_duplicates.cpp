@@ -2,24 +2,21 @@
 
 void RemoveDuplicates(SearchServer& search_server) {
     std::vector<int> duplicates;
-    std::map<std::set<std::string_view>, int> originals;
+    const auto less = [](ArrayView<TermId> lhs, ArrayView<TermId> rhs) {
+        return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    };
+    std::set<ArrayView<TermId>, decltype(less)> originals(less);
+    // Все документы читаются из одного снимка, который держит сегменты, поэтому наборы слов
+    // сравниваются по id термов прямо в прямом индексе, без копирования
+    const auto snapshot = search_server.GetSnapshot();
     for (const auto& document_id : search_server) {
-        std::set<std::string_view> temp;
-        const auto& word_freqs = search_server.GetWordFrequencies(document_id);
-        std::transform(word_freqs.begin(), word_freqs.end(), std::inserter(temp, temp.begin()),
-                       [](const auto& key_value) {
-                           return key_value.first;
-                       });
-        if(originals.count(temp) < 1) {
-            originals.emplace(temp, document_id);
-        }
-        else {
+        if (!originals.insert(snapshot->GetWordFrequencies(document_id).GetTermIds()).second) {
             duplicates.push_back(document_id);
         }
     }
 
     for (const int id : duplicates) {
         std::cout << "Found duplicate document id " << id << std::endl;
-        search_server.RemoveDocument(id);
     }
-}
\ No newline at end of file
+    search_server.RemoveDocuments(duplicates);
+}
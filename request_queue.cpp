@@ -3,9 +3,9 @@
 RequestQueue::RequestQueue(SearchServer &searchServer) : search_server_(searchServer) {
 }
 
+// Поиск по статусу, а не по предикату: такие запросы берутся из кеша результатов сервера
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    return AddFindRequest(raw_query, [status]([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating) {
-        return document_status == status; });
+    return AddRequestResult(search_server_.FindTopDocuments(raw_query, status));
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
@@ -14,4 +14,19 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query)
 
 int RequestQueue::GetNoResultRequests() const {
     return no_result_requests_;
+}
+
+std::vector<Document> RequestQueue::AddRequestResult(std::vector<Document> found_docs) {
+    if (found_docs.empty()) {
+        requests_.push_back({true, found_docs});
+        ++no_result_requests_;
+    }
+    else
+        requests_.push_back({false, found_docs});
+    if (requests_.size() > sec_in_day_) {
+        if (requests_.front().is_empty)
+            --no_result_requests_;
+        requests_.pop_front();
+    }
+    return found_docs;
 }
\ No newline at end of file
@@ -20,6 +20,9 @@ public:
 
     [[nodiscard]] int GetNoResultRequests() const;
 private:
+    // Запоминает результат запроса и возвращает его
+    std::vector<Document> AddRequestResult(std::vector<Document> found_docs);
+
     struct QueryResult {
         bool is_empty;
         std::vector<Document> found_docs;
@@ -32,17 +35,5 @@ private:
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-    std::vector<Document> found_docs = search_server_.FindTopDocuments(raw_query, document_predicate);
-    if (found_docs.empty()) {
-        requests_.push_back({true, found_docs});
-        ++no_result_requests_;
-    }
-    else
-        requests_.push_back({false, found_docs});
-    if (requests_.size() > sec_in_day_) {
-        if (requests_.front().is_empty)
-            --no_result_requests_;
-        requests_.pop_front();
-    }
-    return found_docs;
+    return AddRequestResult(search_server_.FindTopDocuments(raw_query, document_predicate));
 }
\ No newline at end of file
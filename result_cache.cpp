@@ -0,0 +1,102 @@
+#include "result_cache.h"
+
+#include <algorithm>
+
+using namespace std::literals;
+
+bool operator==(const ResultCacheKey& lhs, const ResultCacheKey& rhs) {
+    return lhs.status == rhs.status && lhs.top_k == rhs.top_k
+           && std::equal(lhs.plus_words.begin(), lhs.plus_words.end(), rhs.plus_words.begin(), rhs.plus_words.end())
+           && std::equal(lhs.minus_words.begin(), lhs.minus_words.end(), rhs.minus_words.begin(), rhs.minus_words.end());
+}
+
+size_t ResultCacheKeyHasher::operator()(const ResultCacheKey& key) const {
+    uint64_t hash = 0;
+    const auto combine = [&hash](uint64_t value) {
+        hash = (hash ^ value) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 32;
+    };
+    for (const TermId term_id : key.plus_words) {
+        combine(term_id);
+    }
+    // Размер отделяет плюс-слова от минус-слов
+    combine(key.plus_words.size());
+    for (const TermId term_id : key.minus_words) {
+        combine(term_id);
+    }
+    combine(static_cast<uint64_t>(key.status));
+    combine(key.top_k);
+    return static_cast<size_t>(hash);
+}
+
+std::ostream& operator<<(std::ostream& out, const ResultCacheStats& stats) {
+    return out << "Result cache: "sv << stats.hits << " hits, "sv << stats.misses << " misses, "sv
+               << stats.evictions << " evictions, "sv << stats.invalidations << " invalidations, "sv
+               << stats.size << " entries"sv;
+}
+
+ResultCache::ResultCache(size_t capacity)
+        : shard_capacity_(std::max<size_t>((capacity + SHARD_COUNT - 1) / SHARD_COUNT, 1)) {
+}
+
+std::optional<std::vector<Document>> ResultCache::Find(const ResultCacheKey& key, uint64_t generation) {
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    const auto found = shard.index.find(key);
+    if (found == shard.index.end() || found->second->generation != generation) {
+        if (found != shard.index.end() && found->second->generation < generation) {
+            shard.entries.erase(found->second);
+            shard.index.erase(found);
+            invalidations_.fetch_add(1, std::memory_order_relaxed);
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return found->second->documents;
+}
+
+void ResultCache::Insert(const ResultCacheKey& key, uint64_t generation, const std::vector<Document>& documents) {
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    if (const auto found = shard.index.find(key); found != shard.index.end()) {
+        Entry& entry = *found->second;
+        if (entry.generation > generation) {
+            return;
+        }
+        entry.generation = generation;
+        entry.documents = documents;
+        shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+        return;
+    }
+    shard.entries.push_front({key, generation, documents});
+    shard.index.emplace(key, shard.entries.begin());
+    if (shard.entries.size() > shard_capacity_) {
+        shard.index.erase(shard.entries.back().key);
+        shard.entries.pop_back();
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+size_t ResultCache::GetCapacity() const {
+    return shard_capacity_ * SHARD_COUNT;
+}
+
+ResultCacheStats ResultCache::GetStats() const {
+    ResultCacheStats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.evictions = evictions_.load(std::memory_order_relaxed);
+    stats.invalidations = invalidations_.load(std::memory_order_relaxed);
+    for (const Shard& shard : shards_) {
+        std::lock_guard guard(shard.mutex);
+        stats.size += shard.entries.size();
+    }
+    return stats;
+}
+
+ResultCache::Shard& ResultCache::GetShard(const ResultCacheKey& key) {
+    // Старшие биты хеша выбирают часть, младшие используются таблицей внутри части
+    return shards_[(static_cast<uint64_t>(ResultCacheKeyHasher{}(key)) >> (sizeof(size_t) * 4)) % SHARD_COUNT];
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "small_vector.h"
+#include "term_dictionary.h"
+
+// Ключ кеша результатов: нормализованный запрос (отсортированные id термов плюс- и минус-слов без повторов),
+// статус документов и число результатов. Запросы, которые отличаются только порядком слов, повторами
+// и словами, которых нет в словаре, имеют один ключ
+struct ResultCacheKey {
+    using TermIds = SmallVector<TermId, 16>;
+
+    TermIds plus_words;
+    TermIds minus_words;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    size_t top_k = 0;
+};
+
+bool operator==(const ResultCacheKey& lhs, const ResultCacheKey& rhs);
+
+struct ResultCacheKeyHasher {
+    size_t operator()(const ResultCacheKey& key) const;
+};
+
+// Счетчики кеша результатов
+struct ResultCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;        // Результаты, вытесненные из-за ограничения размера
+    uint64_t invalidations = 0;    // Результаты, отброшенные после изменения индекса
+    size_t size = 0;
+};
+
+std::ostream& operator<<(std::ostream& out, const ResultCacheStats& stats);
+
+// Кеш результатов поиска с вытеснением давно не использованных (LRU). Ключи делятся между SHARD_COUNT
+// частями со своими мьютексами, поэтому запросы из разных потоков редко ждут друг друга.
+// Каждый результат помечен поколением - версией индекса, по которой он посчитан. Результат другого
+// поколения не возвращается: изменение индекса делает недействительными все результаты сразу,
+// а устаревшие записи удаляются при обращении к ним или вытесняются
+class ResultCache {
+public:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    // Кеш хранит не больше capacity результатов, округленных вверх до кратного SHARD_COUNT
+    explicit ResultCache(size_t capacity);
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Результат поколения generation или std::nullopt
+    [[nodiscard]] std::optional<std::vector<Document>> Find(const ResultCacheKey& key, uint64_t generation);
+
+    // Сохранение результата. Результат более нового поколения не заменяется результатом старого:
+    // запросы к старым снимкам индекса не вытесняют актуальные результаты
+    void Insert(const ResultCacheKey& key, uint64_t generation, const std::vector<Document>& documents);
+
+    [[nodiscard]] size_t GetCapacity() const;
+
+    [[nodiscard]] ResultCacheStats GetStats() const;
+
+private:
+    struct Entry {
+        ResultCacheKey key;
+        uint64_t generation;
+        std::vector<Document> documents;
+    };
+
+    // Записи части в порядке последнего использования, от недавних к давним
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<ResultCacheKey, std::list<Entry>::iterator, ResultCacheKeyHasher> index;
+    };
+
+    size_t shard_capacity_;
+    std::array<Shard, SHARD_COUNT> shards_;
+    std::atomic<uint64_t> hits_ = 0;
+    std::atomic<uint64_t> misses_ = 0;
+    std::atomic<uint64_t> evictions_ = 0;
+    std::atomic<uint64_t> invalidations_ = 0;
+
+    [[nodiscard]] Shard& GetShard(const ResultCacheKey& key);
+};
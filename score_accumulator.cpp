@@ -0,0 +1,93 @@
+#include "score_accumulator.h"
+
+void DenseScoreAccumulator::Reset(DocumentOrdinal range_begin, DocumentOrdinal range_end) {
+    for (const DocumentOrdinal ordinal : touched_) {
+        scores_[ordinal - range_begin_] = 0.0;
+        scored_.Reset(ordinal - range_begin_);
+    }
+    touched_.clear();
+    for (const DocumentOrdinal ordinal : excluded_ordinals_) {
+        excluded_.Reset(ordinal - range_begin_);
+    }
+    excluded_ordinals_.clear();
+    range_begin_ = range_begin;
+    const size_t document_count = range_end - range_begin;
+    if (scores_.size() < document_count) {
+        scores_.resize(document_count, 0.0);
+        scored_.Resize(document_count);
+        excluded_.Resize(document_count);
+    }
+}
+
+void DenseScoreAccumulator::Add(DocumentOrdinal ordinal, double score) {
+    const DocumentOrdinal index = ordinal - range_begin_;
+    if (!scored_.Test(index)) {
+        scored_.Set(index);
+        touched_.push_back(ordinal);
+    }
+    scores_[index] += score;
+}
+
+void DenseScoreAccumulator::Exclude(DocumentOrdinal ordinal) {
+    if (!excluded_.Test(ordinal - range_begin_)) {
+        excluded_.Set(ordinal - range_begin_);
+        excluded_ordinals_.push_back(ordinal);
+    }
+}
+
+double DenseScoreAccumulator::GetScore(DocumentOrdinal ordinal) const {
+    return scores_[ordinal - range_begin_];
+}
+
+const std::vector<DocumentOrdinal>& DenseScoreAccumulator::GetTouched() const {
+    return touched_;
+}
+
+DenseScoreAccumulator& DenseScoreAccumulator::ForCurrentThread() {
+    thread_local DenseScoreAccumulator accumulator;
+    return accumulator;
+}
+
+ScoreAccumulatorPool::Lease::Lease(ScoreAccumulatorPool& pool, std::unique_ptr<DenseScoreAccumulator> accumulator)
+        : pool_(&pool)
+        , accumulator_(std::move(accumulator)) {
+}
+
+ScoreAccumulatorPool::Lease::~Lease() {
+    if (accumulator_) {
+        pool_->Release(std::move(accumulator_));
+    }
+}
+
+DenseScoreAccumulator& ScoreAccumulatorPool::Lease::operator*() const {
+    return *accumulator_;
+}
+
+DenseScoreAccumulator* ScoreAccumulatorPool::Lease::operator->() const {
+    return accumulator_.get();
+}
+
+ScoreAccumulatorPool::Lease ScoreAccumulatorPool::Acquire() {
+    std::unique_ptr<DenseScoreAccumulator> accumulator;
+    {
+        std::lock_guard guard(mutex_);
+        if (!free_accumulators_.empty()) {
+            accumulator = std::move(free_accumulators_.back());
+            free_accumulators_.pop_back();
+        }
+    }
+    if (!accumulator) {
+        accumulator = std::make_unique<DenseScoreAccumulator>();
+    }
+    return {*this, std::move(accumulator)};
+}
+
+ScoreAccumulatorPool& ScoreAccumulatorPool::Instance() {
+    static ScoreAccumulatorPool pool;
+    return pool;
+}
+
+void ScoreAccumulatorPool::Release(std::unique_ptr<DenseScoreAccumulator> accumulator) {
+    std::lock_guard guard(mutex_);
+    free_accumulators_.push_back(std::move(accumulator));
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "bitmap.h"
+#include "document.h"
+
+// Способ накопления релевантности документов при поиске
+enum class ScoreAccumulatorType {
+    MAP,    // std::map: узел дерева на каждый найденный документ
+    DENSE,  // плотный массив, индексируемый номером документа
+};
+
+// Плотный накопитель релевантности, индексируемый номером документа относительно начала диапазона.
+// Память нужна только под диапазон номеров, а не под весь сегмент.
+// Номера затронутых документов запоминаются, поэтому сброс стоит столько же,
+// сколько документов было найдено, а не сколько их на сервере.
+// Документы с минус-словами отмечаются в битовой карте исключений до подсчета релевантности,
+// чтобы подсчет мог их пропускать.
+// Накопитель переиспользуется между запросами: у каждого потока он свой (см. ForCurrentThread)
+class DenseScoreAccumulator {
+public:
+    // Подготовка к новому запросу по документам с номерами из [range_begin, range_end)
+    void Reset(DocumentOrdinal range_begin, DocumentOrdinal range_end);
+
+    void Add(DocumentOrdinal ordinal, double score);
+
+    // Исключение документа из результатов (например, из-за минус-слова)
+    void Exclude(DocumentOrdinal ordinal);
+
+    [[nodiscard]] bool IsExcluded(DocumentOrdinal ordinal) const {
+        return excluded_.Test(ordinal - range_begin_);
+    }
+
+    [[nodiscard]] double GetScore(DocumentOrdinal ordinal) const;
+
+    // Номера документов (не относительные), которым была добавлена релевантность
+    [[nodiscard]] const std::vector<DocumentOrdinal>& GetTouched() const;
+
+    // Накопитель текущего потока
+    static DenseScoreAccumulator& ForCurrentThread();
+
+private:
+    DocumentOrdinal range_begin_ = 0;
+    std::vector<double> scores_;
+    Bitmap scored_;
+    std::vector<DocumentOrdinal> touched_;
+    Bitmap excluded_;
+    std::vector<DocumentOrdinal> excluded_ordinals_;
+};
+
+// Пул плотных накопителей для параллельного поиска. Задача берет накопитель из пула
+// на время подсчета и возвращает его по завершении, поэтому при подсчете релевантности
+// задачи не делят память и не используют блокировок, а прогретый пул не выделяет память
+class ScoreAccumulatorPool {
+public:
+    // Накопитель, взятый из пула. Возвращается в пул при разрушении
+    class Lease {
+    public:
+        Lease(ScoreAccumulatorPool& pool, std::unique_ptr<DenseScoreAccumulator> accumulator);
+        Lease(Lease&& other) noexcept = default;
+        Lease& operator=(Lease&& other) noexcept = default;
+        ~Lease();
+
+        DenseScoreAccumulator& operator*() const;
+        DenseScoreAccumulator* operator->() const;
+
+    private:
+        ScoreAccumulatorPool* pool_;
+        std::unique_ptr<DenseScoreAccumulator> accumulator_;
+    };
+
+    [[nodiscard]] Lease Acquire();
+
+    // Общий пул процесса
+    static ScoreAccumulatorPool& Instance();
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<DenseScoreAccumulator>> free_accumulators_;
+
+    void Release(std::unique_ptr<DenseScoreAccumulator> accumulator);
+};
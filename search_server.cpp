@@ -1,6 +1,9 @@
-#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iterator>
 
+#include "binary_io.h"
 #include "document.h"
 #include "search_server.h"
 #include "string_processing.h"
@@ -14,78 +17,224 @@ using std::string;
 using std::string_view;
 using std::vector;
 
-SearchServer::SearchServer(const string& stop_words_text)
-        : SearchServer(SplitIntoWords(stop_words_text)) {
+SearchServer::SearchServer(const string& stop_words_text, const IndexOptions& options)
+        : SearchServer(SplitIntoWords(stop_words_text), options) {
 }
 
-SearchServer::SearchServer(string_view stop_words_text)
-        : SearchServer(SplitIntoWords(stop_words_text)) {
+SearchServer::SearchServer(string_view stop_words_text, const IndexOptions& options)
+        : SearchServer(SplitIntoWords(stop_words_text), options) {
+}
+
+SearchServer::SearchServer(const SearchServer& other) {
+    std::lock_guard guard(other.write_mutex_);
+    options_ = other.options_;
+    stop_words_ = other.stop_words_;
+    // Словарь копируется: копия будет добавлять в него свои термы
+    term_dictionary_ = std::make_shared<TermDictionary>(*other.term_dictionary_);
+    term_statistics_ = other.term_statistics_;
+    sealed_segments_ = other.sealed_segments_;
+    write_segment_ = other.write_segment_;
+    document_ids_ = other.document_ids_;
+    merge_inputs_ = other.merge_inputs_;
+    // Результат слияния общий с исходным сервером, поэтому удаления, сделанные во время слияния,
+    // каждый сервер применяет к своей копии результата (см. InstallMerge)
+    pending_merge_ = other.pending_merge_;
+    removed_during_merge_ = other.removed_during_merge_;
+    // Версии индекса копии считаются заново, поэтому результаты исходного сервера ей не подходят
+    result_cache_ = MakeResultCache(options_);
+}
+
+namespace {
+
+// Заголовок файла индекса. Порядок байт записывается, чтобы файл с другой архитектуры не читался молча
+struct IndexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+};
+
+constexpr char INDEX_FILE_MAGIC[8] = {'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0'};
+constexpr uint32_t INDEX_FILE_BYTE_ORDER = 0x01020304;
+
+// Блок файла индекса: размер и выровненные данные
+void WriteBlock(BinaryWriter& writer, ArrayView<char> bytes) {
+    writer.Write<uint64_t>(bytes.size());
+    writer.WriteArray(bytes);
+    writer.Align();
+}
+
+ArrayView<char> ReadBlock(BinaryReader& reader) {
+    const auto size = reader.Read<uint64_t>();
+    const ArrayView<char> bytes = reader.ReadArray<char>(size);
+    reader.Align();
+    return bytes;
+}
+
+} // namespace
+
+// Сервер, открытый из файла индекса. Файл состоит из заголовка, стоп-слов, словаря, статистики термов
+// и сегментов; каждая часть - блок с размером, выровненный на 8 байт
+SearchServer::SearchServer(std::shared_ptr<const MappedFile> file, const IndexOptions& options)
+        : options_(options)
+        , write_segment_(std::make_shared<IndexSegment>())
+        , result_cache_(MakeResultCache(options)) {
+    BinaryReader reader(file->data(), file->size());
+    const auto header = reader.Read<IndexFileHeader>();
+    if (std::memcmp(header.magic, INDEX_FILE_MAGIC, sizeof(INDEX_FILE_MAGIC)) != 0) {
+        throw std::invalid_argument("Файл не является файлом индекса");
+    }
+    if (header.version != INDEX_FILE_VERSION) {
+        throw std::invalid_argument("Неподдерживаемая версия файла индекса: "s + std::to_string(header.version));
+    }
+    if (header.byte_order != INDEX_FILE_BYTE_ORDER) {
+        throw std::invalid_argument("Файл индекса записан с другим порядком байт");
+    }
+    reader.Align();
+
+    const ArrayView<char> stop_words = ReadBlock(reader);
+    stop_words_ = std::make_shared<const StopWordSet>(MakeUniqueNonEmptyStrings(SplitIntoWords({stop_words.data(), stop_words.size()})));
+    term_dictionary_ = std::make_shared<TermDictionary>(file, ReadBlock(reader));
+    term_statistics_ = TermStatistics(ReadBlock(reader));
+    const auto segment_count = reader.Read<uint64_t>();
+    for (uint64_t index = 0; index < segment_count; ++index) {
+        auto segment = std::make_shared<IndexSegment>(IndexSegment::Open(file, ReadBlock(reader), term_dictionary_->size()));
+        for (DocumentOrdinal ordinal = 0; ordinal < segment->GetOrdinalCount(); ++ordinal) {
+            if (!document_ids_.insert(segment->GetDocumentInfo(ordinal).id).second) {
+                throw std::invalid_argument("Файл индекса поврежден: повторяющийся id документа");
+            }
+        }
+        sealed_segments_.push_back(std::move(segment));
+    }
+    if (!reader.AtEnd()) {
+        throw std::invalid_argument("Файл индекса поврежден: лишние данные в конце");
+    }
+    term_statistics_.SetDocumentCount(document_ids_.size());
 }
 
 void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    std::lock_guard guard(write_mutex_);
     if (document_id < 0) {
         throw std::invalid_argument("Попытка добавить документ с отрицательным id");
     }
-    if (documents_.count(document_id) > 0) {
+    if (document_ids_.count(document_id) > 0) {
         throw std::invalid_argument("Попытка добавить документ c id ранее добавленного документа");
     }
 
-    const auto [it, inserted] = documents_.emplace(document_id, DocumentData {ComputeAverageRating(ratings), status, string{document}});
-    const auto words = SplitIntoWordsNoStop(it->second.text);
-
+    DocumentData data {document_id, ComputeAverageRating(ratings), status,
+                       options_.store_document_text ? document : string_view{}, {}};
+    // Буфер слов переиспользуется между документами
+    thread_local vector<string_view> words;
+    SplitIntoWordsNoStop(document, words);
     const double inv_word_count = 1.0 / words.size();
     for (string_view word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_to_word_freqs_[document_id][word] += inv_word_count;
+        data.word_freqs[term_dictionary_->Intern(word)] += inv_word_count;
     }
+
+    for (const auto [term_id, term_freq] : data.word_freqs) {
+        term_statistics_.AddTerm(term_id);
+    }
+    DetachSegment(write_segment_).AddDocument(std::move(data));
     document_ids_.insert(document_id);
+    term_statistics_.SetDocumentCount(document_ids_.size());
+    ++version_;
+    ++content_version_;
+
+    if (write_segment_->GetOrdinalCount() >= WRITE_SEGMENT_CAPACITY) {
+        SealWriteSegment();
+    } else {
+        InstallMerge(false);
+    }
+}
+
+// Пакетное добавление документов
+void SearchServer::AddDocuments(const vector<NewDocument>& documents) {
+    AddDocuments(std::execution::par, documents);
+}
+
+// Пакетное добавление документов. Последовательная версия
+void SearchServer::AddDocuments(const std::execution::sequenced_policy&, const vector<NewDocument>& documents) {
+    AddDocumentsToSegments(std::execution::seq, documents);
+}
+
+// Пакетное добавление документов. Параллельная версия
+void SearchServer::AddDocuments(const std::execution::parallel_policy&, const vector<NewDocument>& documents) {
+    AddDocumentsToSegments(std::execution::par, documents);
 }
 
 // Поиск наиболее релевантных документов по статусу
-vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(raw_query,
-                            [status]([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating) {
-                                return document_status == status;
-    });
+vector<Document> SearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status, const SearchOptions& options) const {
+    return GetSnapshot()->FindTopDocuments(raw_query, status, options);
 }
 
 // Поиск наиболее релевантных документов по статусу. Последовательная версия
 [[nodiscard]] std::vector<Document>
-SearchServer::FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(std::execution::seq, raw_query,
-                            [status]([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating) {
-                                return document_status == status;
-                            });
+SearchServer::FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentStatus status, const SearchOptions& options) const {
+    return GetSnapshot()->FindTopDocuments(std::execution::seq, raw_query, status, options);
 }
 
 // Поиск наиболее релевантных документов по статусу. Параллельная версия
 [[nodiscard]] std::vector<Document>
-SearchServer::FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(std::execution::par, raw_query,
-                            [status]([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating) {
-                                return document_status == status;
-                            });
+SearchServer::FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentStatus status, const SearchOptions& options) const {
+    return GetSnapshot()->FindTopDocuments(std::execution::par, raw_query, status, options);
 }
 
+PreparedQuery SearchServer::Prepare(string_view raw_query) const {
+    return GetSnapshot()->Prepare(raw_query);
+}
+
+// Поиск по подготовленному запросу по статусу
+vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status, const SearchOptions& options) const {
+    return GetSnapshot()->FindTopDocuments(query, status, options);
+}
+
+// Поиск по подготовленному запросу по статусу. Последовательная версия
+vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, DocumentStatus status,
+                                                const SearchOptions& options) const {
+    return GetSnapshot()->FindTopDocuments(std::execution::seq, query, status, options);
+}
+
+// Поиск по подготовленному запросу по статусу. Параллельная версия
+vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, DocumentStatus status,
+                                                const SearchOptions& options) const {
+    return GetSnapshot()->FindTopDocuments(std::execution::par, query, status, options);
+}
+
+MemoryStats SearchServer::GetMemoryStats() const {
+    std::lock_guard guard(write_mutex_);
+    MemoryStats stats;
+    for (const auto& segment : sealed_segments_) {
+        segment->AddMemoryUsage(stats);
+    }
+    write_segment_->AddMemoryUsage(stats);
+    stats.document_ids.bytes = document_ids_.get_allocator().GetAllocatedBytes();
+    stats.document_ids.elements = document_ids_.size();
+    term_dictionary_->AddMemoryUsage(stats);
+    term_statistics_.AddMemoryUsage(stats);
+    stats.stop_words.bytes = stop_words_->GetAllocatedBytes();
+    stats.stop_words.elements = stop_words_->size();
+    return stats;
+}
 
-std::set<int>::const_iterator SearchServer::begin() const {
+ResultCacheStats SearchServer::GetResultCacheStats() const {
+    return result_cache_ ? result_cache_->GetStats() : ResultCacheStats{};
+}
+
+SearchServer::DocumentIdSet::const_iterator SearchServer::begin() const {
     return document_ids_.cbegin();
 }
 
-std::set<int>::const_iterator SearchServer::end() const {
+SearchServer::DocumentIdSet::const_iterator SearchServer::end() const {
     return document_ids_.cend();
 }
 
 // Возвращает количество документов на сервере
 int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return GetSnapshot()->GetDocumentCount();
 }
 
 // Метод получения частот слов по id документа
-std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
-    static const std::map<string_view, double> empty_map;
-    const auto found = document_to_word_freqs_.find(document_id);
-    return (found != document_to_word_freqs_.end()) ? found->second : empty_map;
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const {
+    return GetSnapshot()->GetWordFrequencies(document_id);
 }
 
 // Возвращает все слова из поискового запроса, присутствующие в документе.
@@ -96,53 +245,62 @@ std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document
 // Возвращает все слова из поискового запроса, присутствующие в документе.
 // Последовательная версия
 [[nodiscard]] SearchServer::MatchDocumentResult SearchServer::MatchDocument(const std::execution::sequenced_policy&, string_view raw_query, int document_id) const {
-    const Query query = ParseQuery(raw_query);
-    vector<std::string_view> matched_words;
-    for (string_view word : query.plus_words) {
-        auto found_documents = word_to_document_freqs_.find(std::string(word));
-        if (found_documents == word_to_document_freqs_.end()) {
-            continue;
-        }
-        if (found_documents->second.count(document_id)) {
-            matched_words.emplace_back(word);
-        }
-    }
-    for (string_view word : query.minus_words) {
-        auto found_documents = word_to_document_freqs_.find(std::string(word));
-        if (found_documents == word_to_document_freqs_.end()) {
-            continue;
-        }
-        if (found_documents->second.count(document_id)) {
-            matched_words.clear();
-            break;
-        }
-    }
-    return {matched_words, documents_.at(document_id).status};
+    return GetSnapshot()->MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
 // Возвращает все слова из поискового запроса, присутствующие в документе.
 // Параллельная версия
 [[nodiscard]] SearchServer::MatchDocumentResult SearchServer::MatchDocument(const std::execution::parallel_policy&, string_view raw_query, int document_id) const {
-    const Query query = ParseQuery(raw_query);
-    std::vector<string_view> matched_words;
+    return GetSnapshot()->MatchDocument(std::execution::par, raw_query, document_id);
+}
 
-    const auto word_checker = [this, document_id](string_view word) {
-        const auto found = word_to_document_freqs_.find(word);
-        return found != word_to_document_freqs_.end() && found->second.count(document_id);
-    };
+// Слова подготовленного запроса, присутствующие в документе
+SearchServer::MatchDocumentResult SearchServer::MatchDocument(const PreparedQuery& query, int document_id) const {
+    return MatchDocument(std::execution::seq, query, document_id);
+}
 
-    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), word_checker)) {
-        return { matched_words, documents_.at(document_id).status };
-    }
+// Слова подготовленного запроса, присутствующие в документе. Последовательная версия
+SearchServer::MatchDocumentResult SearchServer::MatchDocument(const std::execution::sequenced_policy&, const PreparedQuery& query, int document_id) const {
+    return GetSnapshot()->MatchDocument(std::execution::seq, query, document_id);
+}
 
-    std::copy_if(
-        std::execution::par,
-        query.plus_words.begin(), query.plus_words.end(),
-        std::back_inserter(matched_words),
-        word_checker
-    );
+// Слова подготовленного запроса, присутствующие в документе. Параллельная версия
+SearchServer::MatchDocumentResult SearchServer::MatchDocument(const std::execution::parallel_policy&, const PreparedQuery& query, int document_id) const {
+    return GetSnapshot()->MatchDocument(std::execution::par, query, document_id);
+}
+
+// Слова запроса, присутствующие в каждом из документов
+vector<SearchServer::MatchDocumentResult> SearchServer::MatchDocuments(string_view raw_query, const vector<int>& document_ids) const {
+    return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+// Слова запроса, присутствующие в каждом из документов. Последовательная версия
+vector<SearchServer::MatchDocumentResult> SearchServer::MatchDocuments(const std::execution::sequenced_policy&, string_view raw_query,
+                                                                       const vector<int>& document_ids) const {
+    return GetSnapshot()->MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+// Слова запроса, присутствующие в каждом из документов. Параллельная версия
+vector<SearchServer::MatchDocumentResult> SearchServer::MatchDocuments(const std::execution::parallel_policy&, string_view raw_query,
+                                                                       const vector<int>& document_ids) const {
+    return GetSnapshot()->MatchDocuments(std::execution::par, raw_query, document_ids);
+}
 
-    return { matched_words, documents_.at(document_id).status};
+// Слова подготовленного запроса, присутствующие в каждом из документов
+vector<SearchServer::MatchDocumentResult> SearchServer::MatchDocuments(const PreparedQuery& query, const vector<int>& document_ids) const {
+    return MatchDocuments(std::execution::seq, query, document_ids);
+}
+
+// Слова подготовленного запроса, присутствующие в каждом из документов. Последовательная версия
+vector<SearchServer::MatchDocumentResult> SearchServer::MatchDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query,
+                                                                       const vector<int>& document_ids) const {
+    return GetSnapshot()->MatchDocuments(std::execution::seq, query, document_ids);
+}
+
+// Слова подготовленного запроса, присутствующие в каждом из документов. Параллельная версия
+vector<SearchServer::MatchDocumentResult> SearchServer::MatchDocuments(const std::execution::parallel_policy&, const PreparedQuery& query,
+                                                                       const vector<int>& document_ids) const {
+    return GetSnapshot()->MatchDocuments(std::execution::par, query, document_ids);
 }
 
 // Удаление документов из поискового сервера
@@ -153,59 +311,163 @@ void SearchServer::RemoveDocument(int document_id) {
 // Удаление документов из поискового сервера
 // Последовательная версия
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id) {
-    const auto& found = GetWordFrequencies(document_id);
-    if (!found.empty()) {
-        for (const auto& [word, freq] : found) {
-            word_to_document_freqs_[string(word)].erase(document_id);
-        }
-        document_to_word_freqs_.erase(document_id);
-        document_ids_.erase(document_id);
-        documents_.erase(document_id);
-    }
+    RemoveDocumentFromSegment(document_id);
 }
 
 // Удаление документов из поискового сервера
 // Параллельная версия
 void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id) {
-    const auto& found = GetWordFrequencies(document_id);
-    if (!found.empty()) {
-        std::for_each(std::execution::par, found.begin(), found.end(),
-              [this, document_id](auto& word_freq) {
-                  word_to_document_freqs_[word_freq.first].erase(document_id);
-              });
-        document_to_word_freqs_.erase(document_id);
-        document_ids_.erase(document_id);
-        documents_.erase(document_id);
+    RemoveDocumentFromSegment(document_id);
+}
+
+// Пакетное удаление документов
+void SearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    RemoveDocuments(std::execution::par, document_ids);
+}
+
+// Пакетное удаление документов. Последовательная версия
+void SearchServer::RemoveDocuments(const std::execution::sequenced_policy&, const vector<int>& document_ids) {
+    RemoveDocumentsFromSegments(std::execution::seq, document_ids);
+}
+
+// Пакетное удаление документов. Параллельная версия
+void SearchServer::RemoveDocuments(const std::execution::parallel_policy&, const vector<int>& document_ids) {
+    RemoveDocumentsFromSegments(std::execution::par, document_ids);
+}
+
+// Количество запечатанных сегментов индекса
+size_t SearchServer::GetSegmentCount() const {
+    std::lock_guard guard(write_mutex_);
+    return sealed_segments_.size();
+}
+
+// Количество удаленных документов, вхождения которых еще не вычищены
+size_t SearchServer::GetDeletedDocumentCount() const {
+    std::lock_guard guard(write_mutex_);
+    size_t deleted_count = write_segment_->GetDeletedCount();
+    for (const auto& segment : sealed_segments_) {
+        deleted_count += segment->GetDeletedCount();
     }
+    return deleted_count;
 }
 
+// Ожидание завершения фонового слияния сегментов
+void SearchServer::WaitForMerge() {
+    std::lock_guard guard(write_mutex_);
+    // Установка результата может запустить следующее слияние
+    while (pending_merge_.valid()) {
+        InstallMerge(true);
+    }
+}
 
-// Реализация private методов класса SearchServer
-// Проверка на стоп-слова
-bool SearchServer::IsStopWord(const string& word) const {
-    return stop_words_.count(word) > 0;
+// Сохранение текущей версии индекса в файл
+void SearchServer::SaveSnapshot(const string& path) const {
+    // Под блокировкой берутся только ссылки на неизменяемые сегменты и копии словаря и статистики,
+    // поэтому запись файла не задерживает изменения сервера
+    std::vector<std::shared_ptr<const IndexSegment>> segments;
+    std::vector<char> head;
+    BinaryWriter writer(head);
+    {
+        std::lock_guard guard(write_mutex_);
+        segments.assign(sealed_segments_.begin(), sealed_segments_.end());
+        segments.push_back(write_segment_);
+
+        IndexFileHeader header{{}, INDEX_FILE_VERSION, INDEX_FILE_BYTE_ORDER};
+        std::memcpy(header.magic, INDEX_FILE_MAGIC, sizeof(INDEX_FILE_MAGIC));
+        writer.Write(header);
+        writer.Align();
+        string stop_words;
+        for (const string_view word : *stop_words_) {
+            stop_words += word;
+            stop_words += ' ';
+        }
+        WriteBlock(writer, {stop_words.data(), stop_words.size()});
+        WriteBlock(writer, term_dictionary_->Serialize());
+        WriteBlock(writer, term_statistics_.Serialize());
+    }
+
+    // В файл попадают только неудаленные документы: сегменты с отметками об удалении и сегмент записи
+    // сливаются сами с собой
+    for (auto& segment : segments) {
+        if (!segment->IsSealed() || segment->GetDeletedCount() > 0) {
+            segment = std::make_shared<const IndexSegment>(IndexSegment::Merge({segment}));
+        }
+    }
+    segments.erase(std::remove_if(segments.begin(), segments.end(),
+                                  [](const auto& segment) {
+                                      return segment->GetDocumentCount() == 0;
+                                  }),
+                   segments.end());
+    writer.Write<uint64_t>(segments.size());
+
+    const string temp_path = path + ".tmp"s;
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        out.write(head.data(), static_cast<std::streamsize>(head.size()));
+        for (const auto& segment : segments) {
+            // Двоичное представление сегмента уже выровнено, поэтому пишется как есть
+            const ArrayView<char> bytes = segment->GetBytes();
+            const uint64_t size = bytes.size();
+            out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+        out.close();
+        if (!out) {
+            std::remove(temp_path.c_str());
+            throw std::runtime_error("Не удалось записать файл индекса "s + temp_path);
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Не удалось переименовать файл индекса в "s + path);
+    }
 }
 
-// Проверка на наличие в слове спец-символов
-bool SearchServer::IsValidWord(string_view word) {
-    // A valid word must not contain special characters
-    return std::none_of(word.begin(), word.end(), [](char c) {
-        return c >= '\0' && c < ' ';
-    });
+// Открытие индекса, сохраненного SaveSnapshot
+SearchServer SearchServer::OpenSnapshot(const string& path, const IndexOptions& options) {
+    return SearchServer(MappedFile::Open(path), options);
 }
 
-// Разделяет строку на отдельные слова и возвращает их в векторе, исключая стоп-слова
-vector<string_view> SearchServer::SplitIntoWordsNoStop(string_view text) const {
-    vector<string_view> words;
-    for (string_view word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw std::invalid_argument("Наличие недопустимых символов (с кодами от 0 до 31) в тексте добавляемого документа");
+// Снимок текущей версии индекса
+std::shared_ptr<const IndexSnapshot> SearchServer::GetSnapshot() const {
+    {
+        std::lock_guard guard(snapshot_mutex_);
+        if (snapshot_ && snapshot_version_ == version_.load()) {
+            return snapshot_;
         }
-        if (!IsStopWord(string(word))) {
-            words.emplace_back(word);
+    }
+    // Новую версию строит первый запрос после изменения. Он ждет только текущую операцию записи,
+    // а запросы, уже получившие снимок, продолжают работать с ним
+    std::lock_guard write_guard(write_mutex_);
+    std::lock_guard guard(snapshot_mutex_);
+    if (!snapshot_ || snapshot_version_ != version_.load()) {
+        std::vector<std::shared_ptr<const IndexSegment>> segments(sealed_segments_.begin(), sealed_segments_.end());
+        if (write_segment_->GetOrdinalCount() > 0) {
+            segments.push_back(write_segment_);
         }
+        snapshot_ = std::make_shared<const IndexSnapshot>(stop_words_, term_dictionary_, std::move(segments),
+                                                          term_statistics_.GetInverseDocumentFreqs(), document_ids_.size(),
+                                                          content_version_, result_cache_);
+        snapshot_version_ = version_.load();
     }
-    return words;
+    return snapshot_;
+}
+
+
+// Реализация private методов класса SearchServer
+// Проверка на стоп-слова
+bool SearchServer::IsStopWord(string_view word) const {
+    return stop_words_->Contains(word);
+}
+
+// Разделяет строку на отдельные слова и возвращает их в векторе, исключая стоп-слова
+void SearchServer::SplitIntoWordsNoStop(string_view text, vector<string_view>& words) const {
+    if (!SplitIntoWords(text, words)) {
+        throw std::invalid_argument("Наличие недопустимых символов (с кодами от 0 до 31) в тексте добавляемого документа");
+    }
+    words.erase(std::remove_if(words.begin(), words.end(), [this](string_view word) {
+        return IsStopWord(word);
+    }), words.end());
 }
 
 // Вычисление среднего рейтинга
@@ -220,42 +482,223 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
-    if (text.empty()) {
-        throw std::invalid_argument("В тексте запроса нет слов");
+std::shared_ptr<ResultCache> SearchServer::MakeResultCache(const IndexOptions& options) {
+    if (options.result_cache_capacity == 0) {
+        return nullptr;
+    }
+    return std::make_shared<ResultCache>(options.result_cache_capacity);
+}
+
+std::optional<SearchServer::DocumentLocation> SearchServer::FindDocumentLocation(int document_id) const {
+    if (document_ids_.count(document_id) == 0) {
+        return std::nullopt;
+    }
+    for (size_t index = 0; index < sealed_segments_.size(); ++index) {
+        if (const auto ordinal = sealed_segments_[index]->FindDocument(document_id)) {
+            return DocumentLocation{sealed_segments_[index].get(), index, *ordinal};
+        }
+    }
+    if (const auto ordinal = write_segment_->FindDocument(document_id)) {
+        return DocumentLocation{write_segment_.get(), sealed_segments_.size(), *ordinal};
     }
-    bool is_minus = false;
-    if (text[0] == '-') {
-        is_minus = true;
-        text.remove_prefix(1);
+    return std::nullopt;
+}
+
+void SearchServer::CheckNewDocumentIds(const vector<NewDocument>& documents) const {
+    std::unordered_set<int> batch_ids;
+    batch_ids.reserve(documents.size());
+    for (const NewDocument& document : documents) {
+        if (document.id < 0) {
+            throw std::invalid_argument("Попытка добавить документ с отрицательным id");
+        }
+        if (document_ids_.count(document.id) > 0 || !batch_ids.insert(document.id).second) {
+            throw std::invalid_argument("Попытка добавить документ c id ранее добавленного документа");
+        }
     }
-    if (text.empty())
-        throw std::invalid_argument("Отсутствие текста после символа «минус»: в поисковом запросе");
-    if (text[0] == '-')
-        throw std::invalid_argument("Наличие более чем одного минуса перед словами, которых не должно быть в искомых документах");
-    if (!IsValidWord(text))
-        throw std::invalid_argument("Отсутствие текста после символа «минус»: в поисковом запросе");
+}
 
-    return {text, is_minus, IsStopWord(string(text))};
+SearchServer::PreparedDocument SearchServer::PrepareDocument(string_view text) const {
+    thread_local vector<string_view> words;
+    SplitIntoWordsNoStop(text, words);
+    std::sort(words.begin(), words.end());
+
+    PreparedDocument document;
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (i == 0 || words[i - 1] != words[i]) {
+            document.words.push_back(words[i]);
+            document.word_counts.push_back(0);
+        }
+        ++document.word_counts.back();
+    }
+    return document;
 }
 
-SearchServer::Query SearchServer::ParseQuery(string_view text) const {
-    Query query;
-    for (string_view word : SplitIntoWords(text)) {
-        const QueryWord query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                query.minus_words.insert(query_word.data);
-            } else {
-                query.plus_words.insert(query_word.data);
-            }
+void SearchServer::InternWords(PreparedDocument& document) {
+    document.term_ids.resize(document.words.size());
+    for (size_t i = 0; i < document.words.size(); ++i) {
+        document.term_ids[i] = term_dictionary_->Intern(document.words[i]);
+    }
+}
+
+void SearchServer::SortByTermId(PreparedDocument& document) {
+    // Id терма и число вхождений упакованы в одно число, поэтому сортируются без перестановки пар
+    thread_local vector<uint64_t> terms;
+    terms.resize(document.term_ids.size());
+    uint32_t word_count = 0;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        terms[i] = (uint64_t{document.term_ids[i]} << 32) | document.word_counts[i];
+        word_count += document.word_counts[i];
+    }
+    std::sort(terms.begin(), terms.end());
+
+    const double inv_word_count = 1.0 / word_count;
+    document.term_freqs.resize(terms.size());
+    for (size_t i = 0; i < terms.size(); ++i) {
+        document.term_ids[i] = static_cast<TermId>(terms[i] >> 32);
+        // Частота набирается так же, как в AddDocument, поэтому релевантность совпадает
+        double term_freq = 0.0;
+        for (uint32_t count = static_cast<uint32_t>(terms[i]); count > 0; --count) {
+            term_freq += inv_word_count;
         }
+        document.term_freqs[i] = term_freq;
+    }
+}
+
+IndexSegment& SearchServer::DetachSegment(std::shared_ptr<IndexSegment>& segment) {
+    if (segment.use_count() > 1) {
+        segment = std::make_shared<IndexSegment>(*segment);
+    } else {
+        // Последняя чужая ссылка могла быть освобождена в другом потоке:
+        // его чтения сегмента должны завершиться до изменения
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *segment;
+}
+
+void SearchServer::RemoveDocumentFromSegment(int document_id) {
+    std::lock_guard guard(write_mutex_);
+    const auto location = FindDocumentLocation(document_id);
+    if (!location) {
+        return;
+    }
+    MarkDocumentRemoved(document_id, *location);
+    term_statistics_.SetDocumentCount(document_ids_.size());
+    ++version_;
+    ++content_version_;
+    MaintainSegmentsAfterRemoval();
+}
+
+void SearchServer::MarkDocumentRemoved(int document_id, const DocumentLocation& location) {
+    // location.segment мог быть заменен копией при удалении предыдущего документа пакета, поэтому сегмент берется по индексу
+    auto& segment = location.segment_index == sealed_segments_.size() ? write_segment_ : sealed_segments_[location.segment_index];
+    for (const TermId term_id : segment->GetWordFreqs(location.ordinal).term_ids) {
+        term_statistics_.RemoveTerm(term_id);
+    }
+    // Если сегмент читают запросы или слияние, отметка делается в копии. Копия разделяет с ним списки
+    // вхождений и куски карты удаленных, поэтому стоит O(число документов / ChunkedBitmap::CHUNK_BITS)
+    // на копирование указателей и один скопированный кусок карты
+    DetachSegment(segment).RemoveDocument(location.ordinal);
+    if (pending_merge_.valid()) {
+        removed_during_merge_.push_back(document_id);
+    }
+    document_ids_.erase(document_id);
+}
+
+void SearchServer::MaintainSegmentsAfterRemoval() {
+    sealed_segments_.erase(std::remove_if(sealed_segments_.begin(), sealed_segments_.end(),
+                                          [](const auto& segment) {
+                                              return segment->GetDocumentCount() == 0;
+                                          }),
+                           sealed_segments_.end());
+    CompactWriteSegmentIfNeeded();
+    InstallMerge(false);
+    StartMergeIfNeeded();
+}
+
+void SearchServer::CompactWriteSegmentIfNeeded() {
+    if (write_segment_->GetDeletedCount() > write_segment_->GetOrdinalCount() * MAX_DELETED_RATIO) {
+        write_segment_ = std::make_shared<IndexSegment>(write_segment_->Compact());
     }
-    return query;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+void SearchServer::SealWriteSegment() {
+    DetachSegment(write_segment_).Seal();
+    sealed_segments_.push_back(std::move(write_segment_));
+    write_segment_ = std::make_shared<IndexSegment>();
+    InstallMerge(false);
+    StartMergeIfNeeded();
+}
+
+void SearchServer::InstallMerge(bool wait) {
+    if (!pending_merge_.valid()) {
+        return;
+    }
+    if (!wait && pending_merge_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    std::shared_ptr<IndexSegment> merged = pending_merge_.get();
+    pending_merge_ = {};
+    // Результат слияния может принадлежать и копиям сервера, поэтому отметки ставятся в отделенной копии
+    for (const int document_id : removed_during_merge_) {
+        if (const auto ordinal = merged->FindDocument(document_id)) {
+            DetachSegment(merged).RemoveDocument(*ordinal);
+        }
+    }
+    removed_during_merge_.clear();
+    // Во время слияния входные сегменты могли замениться копиями с новыми отметками об удалении
+    sealed_segments_.erase(std::remove_if(sealed_segments_.begin(), sealed_segments_.end(),
+                                          [this](const auto& segment) {
+                                              return std::any_of(merge_inputs_.begin(), merge_inputs_.end(), [&segment](const auto& input) {
+                                                  return segment->SharesData(*input);
+                                              });
+                                          }),
+                           sealed_segments_.end());
+    merge_inputs_.clear();
+    if (merged->GetDocumentCount() > 0) {
+        sealed_segments_.push_back(std::move(merged));
+    }
+    ++version_;
+    // Новый сегмент может заполнить следующий уровень
+    StartMergeIfNeeded();
+}
+
+void SearchServer::StartMergeIfNeeded() {
+    if (pending_merge_.valid()) {
+        return;
+    }
+    // Уровень сегмента определяется его размером: каждый следующий уровень в MERGE_FACTOR раз больше
+    std::map<size_t, std::vector<std::shared_ptr<IndexSegment>>> tiers;
+    for (const auto& segment : sealed_segments_) {
+        size_t tier = 0;
+        for (size_t bound = WRITE_SEGMENT_CAPACITY; segment->GetOrdinalCount() > bound; bound *= MERGE_FACTOR) {
+            ++tier;
+        }
+        auto& tier_segments = tiers[tier];
+        tier_segments.push_back(segment);
+        if (tier_segments.size() == MERGE_FACTOR) {
+            StartMerge(tier_segments);
+            return;
+        }
+    }
+    // Сегмент, в котором много удаленных документов, сливается сам с собой - так вычищаются его вхождения
+    for (const auto& segment : sealed_segments_) {
+        if (segment->GetDeletedCount() > segment->GetOrdinalCount() * MAX_DELETED_RATIO) {
+            StartMerge({segment});
+            return;
+        }
+    }
+}
+
+void SearchServer::StartMerge(std::vector<std::shared_ptr<IndexSegment>> segments) {
+    merge_inputs_ = std::move(segments);
+    // Слияние получает копии сегментов: отметки об удалении, сделанные после его начала, ему не видны
+    std::vector<std::shared_ptr<const IndexSegment>> inputs;
+    for (const auto& segment : merge_inputs_) {
+        inputs.push_back(std::make_shared<const IndexSegment>(*segment));
+    }
+    pending_merge_ = std::async(std::launch::async, [inputs = std::move(inputs)] {
+                         return std::make_shared<IndexSegment>(IndexSegment::Merge(inputs));
+                     }).share();
 }
 
 
@@ -304,11 +747,12 @@ void PrintMatchDocumentResult(int document_id, const std::vector<std::string_vie
 void MatchDocuments(const SearchServer& search_server, const string& query) {
     try {
         cout << "Матчинг документов по запросу: "s << query << endl;
-        const int document_count = search_server.GetDocumentCount();
-        for (int index = 0; index < document_count; ++index) {
-            const int document_id = *(std::next(search_server.begin(), index));
-            const auto [words, status] = search_server.MatchDocument(query, document_id);
-            PrintMatchDocumentResult(document_id, words, status);
+        // Запрос разбирается один раз, все документы сопоставляются одним вызовом
+        const vector<int> document_ids(search_server.begin(), search_server.end());
+        const auto results = search_server.MatchDocuments(query, document_ids);
+        for (size_t index = 0; index < document_ids.size(); ++index) {
+            const auto& [words, status] = results[index];
+            PrintMatchDocumentResult(document_ids[index], words, status);
         }
     } catch (const exception& e) {
         cout << "Ошибка матчинга документов на запрос "s << query << ": "s << e.what() << endl;
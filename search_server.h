@@ -1,69 +1,167 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <execution>
+#include <future>
+#include <limits>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <set>
 #include <string>
-#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
-#include "concurrent_map.h"
 #include "document.h"
+#include "index_segment.h"
+#include "index_snapshot.h"
 #include "log_duration.h"
+#include "mapped_file.h"
 #include "read_input_functions.h"
+#include "result_cache.h"
+#include "stop_word_set.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
+#include "term_statistics.h"
+
+// Документ для пакетного добавления. Текст должен быть действителен до окончания AddDocuments
+struct NewDocument {
+    int id;
+    std::string_view text;
+    DocumentStatus status;
+    std::vector<int> ratings;
+};
 
-constexpr int MAX_RESULT_DOCUMENT_COUNT = 5;
+// Параметры индекса, задаваемые при создании сервера
+struct IndexOptions {
+    // Хранить исходные тексты документов. Запросам тексты не нужны: без них сервер хранит только термы
+    // в словаре и частоты, и память сокращается примерно на размер корпуса
+    bool store_document_text = true;
+    // Сколько результатов поиска по статусу хранить в кеше (см. ResultCache). 0 - кеш выключен.
+    // Кеш полезен, когда одни и те же запросы повторяются чаще, чем меняется индекс
+    size_t result_cache_capacity = 0;
+};
 
+// Поисковый сервер. Изменения (добавление и удаление документов) выполняются по одному,
+// а запросы работают с неизменяемыми снимками индекса и не блокируются записью.
+// Снимок публикуется лениво: первый запрос после изменения строит новую версию
 class SearchServer {
 public:
+    // Сколько документов принимает сегмент записи до запечатывания
+    static constexpr size_t WRITE_SEGMENT_CAPACITY = 4096;
+    // Сколько сегментов одного уровня сливаются в один сегмент следующего уровня
+    static constexpr size_t MERGE_FACTOR = 4;
+    // Доля удаленных документов, после которой сегмент сливается сам с собой
+    static constexpr double MAX_DELETED_RATIO = 0.25;
+    // Версия формата файла индекса. Файлы других версий не открываются
+    static constexpr uint32_t INDEX_FILE_VERSION = 1;
+
+    // Множество id документов. Распределитель считает память узлов множества
+    using DocumentIdSet = std::set<int, std::less<int>, TrackingAllocator<int>>;
 
     // Конструктор инициализирующий сервер стоп-словами из контейнера
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
+    explicit SearchServer(const StringContainer& stop_words, const IndexOptions& options = {});
 
     // Конструктор инициализирующий сервер стоп-словами из строки
-    explicit SearchServer(const std::string& stop_words_text);
+    explicit SearchServer(const std::string& stop_words_text, const IndexOptions& options = {});
 
     // Конструктор инициализирующий сервер стоп-словами из std::string_view
-    explicit SearchServer(std::string_view stop_words_text);
+    explicit SearchServer(std::string_view stop_words_text, const IndexOptions& options = {});
+
+    // Копия получает свой словарь термов, а сегменты разделяет с исходным сервером до первого изменения
+    SearchServer(const SearchServer& other);
+    SearchServer& operator=(const SearchServer&) = delete;
 
     // Добавление документа
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Пакетное добавление документов. Пакет добавляется целиком: при ошибке в любом документе
+    // сервер не меняется. Документы пакета сразу попадают в новые запечатанные сегменты
+    void AddDocuments(const std::vector<NewDocument>& documents);
+
+    // Пакетное добавление документов. Последовательная версия
+    void AddDocuments(const std::execution::sequenced_policy&, const std::vector<NewDocument>& documents);
+
+    // Пакетное добавление документов. Параллельная версия: разбор текстов и построение сегментов
+    // выполняются в нескольких потоках
+    void AddDocuments(const std::execution::parallel_policy&, const std::vector<NewDocument>& documents);
+
     // Поиск наиболее релевантных документов по предикату
     template <typename DocumentPredicate>
-    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const; // [Исправил]
+    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                         const SearchOptions& options = {}) const; // [Исправил]
 
     // Поиск наиболее релевантных документов по статусу
-    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+    [[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                         const SearchOptions& options = {}) const;
 
     // Поиск наиболее релевантных документов по предикату. Последовательная версия
     template <typename DocumentPredicate>
-    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentPredicate document_predicate) const; // [Исправил]
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                         const SearchOptions& options = {}) const; // [Исправил]
 
     // Поиск наиболее релевантных документов по статусу. Последовательная версия
-    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                         const SearchOptions& options = {}) const;
 
     // Поиск наиболее релевантных документов по предикату. Параллельная версия
     template <typename DocumentPredicate>
-    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentPredicate document_predicate) const; // [Исправил]
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentPredicate document_predicate,
+                                                         const SearchOptions& options = {}) const; // [Исправил]
 
     // Поиск наиболее релевантных документов по статусу. Параллельная версия
-    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                         const SearchOptions& options = {}) const;
+
+    // Разбор запроса один раз для многих вызовов FindTopDocuments и MatchDocument: слова переводятся в id термов
+    // и для плюс-слов запоминаются IDF. Если сервер с тех пор изменился, запрос разбирается заново по сохраненному тексту.
+    // При ошибке в запросе выбрасывается std::invalid_argument
+    [[nodiscard]] PreparedQuery Prepare(std::string_view raw_query) const;
+
+    // Поиск по подготовленному запросу по предикату
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate,
+                                                         const SearchOptions& options = {}) const;
+
+    // Поиск по подготовленному запросу по статусу
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                         const SearchOptions& options = {}) const;
+
+    // Поиск по подготовленному запросу по предикату. Последовательная версия
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, DocumentPredicate document_predicate,
+                                                         const SearchOptions& options = {}) const;
+
+    // Поиск по подготовленному запросу по статусу. Последовательная версия
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                         const SearchOptions& options = {}) const;
+
+    // Поиск по подготовленному запросу по предикату. Параллельная версия
+    template <typename DocumentPredicate>
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, DocumentPredicate document_predicate,
+                                                         const SearchOptions& options = {}) const;
+
+    // Поиск по подготовленному запросу по статусу. Параллельная версия
+    [[nodiscard]] std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                                         const SearchOptions& options = {}) const;
 
-    [[nodiscard]] std::set<int>::const_iterator begin() const;
-    [[nodiscard]] std::set<int>::const_iterator end() const;
+    // Обход id документов. В отличие от запросов, не защищен от одновременного изменения сервера
+    [[nodiscard]] DocumentIdSet::const_iterator begin() const;
+    [[nodiscard]] DocumentIdSet::const_iterator end() const;
 
     // Возвращает количество документов на сервере
     [[nodiscard]] int GetDocumentCount() const;
 
-    // Метод получения частот слов по id документа
-    [[nodiscard]] std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+    // Метод получения частот слов по id документа. Частоты не копируются, для отсутствующего документа вид пуст
+    [[nodiscard]] WordFrequencies GetWordFrequencies(int document_id) const;
 
-    using MatchDocumentResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
+    using MatchDocumentResult = IndexSnapshot::MatchDocumentResult;
 
     // Возвращеет все слова из поискового запроса, присутствующие в документе.
     [[nodiscard]] MatchDocumentResult MatchDocument(std::string_view raw_query, int document_id) const;
@@ -74,70 +172,208 @@ public:
     // Возвращеет все слова из поискового запроса, присутствующие в документе. Параллельная версия
     [[nodiscard]] MatchDocumentResult MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const;
 
-    // Удаление документов из поискового сервера
+    // Слова подготовленного запроса, присутствующие в документе
+    [[nodiscard]] MatchDocumentResult MatchDocument(const PreparedQuery& query, int document_id) const;
+
+    // Слова подготовленного запроса, присутствующие в документе. Последовательная версия
+    [[nodiscard]] MatchDocumentResult MatchDocument(const std::execution::sequenced_policy&, const PreparedQuery& query, int document_id) const;
+
+    // Слова подготовленного запроса, присутствующие в документе. Параллельная версия
+    [[nodiscard]] MatchDocumentResult MatchDocument(const std::execution::parallel_policy&, const PreparedQuery& query, int document_id) const;
+
+    // Слова запроса, присутствующие в каждом из документов. Запрос разбирается один раз, все документы
+    // сопоставляются с одним снимком индекса. Результаты идут в порядке document_ids
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocuments(std::string_view raw_query, const std::vector<int>& document_ids) const;
+
+    // Слова запроса, присутствующие в каждом из документов. Последовательная версия
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocuments(const std::execution::sequenced_policy&, std::string_view raw_query,
+                                                                  const std::vector<int>& document_ids) const;
+
+    // Слова запроса, присутствующие в каждом из документов. Параллельная версия: документы делятся между потоками
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocuments(const std::execution::parallel_policy&, std::string_view raw_query,
+                                                                  const std::vector<int>& document_ids) const;
+
+    // Слова подготовленного запроса, присутствующие в каждом из документов
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocuments(const PreparedQuery& query, const std::vector<int>& document_ids) const;
+
+    // Слова подготовленного запроса, присутствующие в каждом из документов. Последовательная версия
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query,
+                                                                  const std::vector<int>& document_ids) const;
+
+    // Слова подготовленного запроса, присутствующие в каждом из документов. Параллельная версия
+    [[nodiscard]] std::vector<MatchDocumentResult> MatchDocuments(const std::execution::parallel_policy&, const PreparedQuery& query,
+                                                                  const std::vector<int>& document_ids) const;
+
+    // Удаление документов из поискового сервера. Документ только отмечается удаленным,
+    // его вхождения вычищаются при слиянии, когда доля удаленных документов сегмента превысит MAX_DELETED_RATIO
     void RemoveDocument(int document_id);
 
     // Удаление документов из поискового сервера. Последовательная версия
     void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
 
-    // Удаление документов из поискового сервера. Параллельная версия
+    // Удаление документов из поискового сервера. Параллельная версия.
+    // Удаление занимает O(1) по спискам вхождений, поэтому совпадает с последовательной версией
     void RemoveDocument(const std::execution::parallel_policy&, int document_id);
 
-private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
-        std::string text;   // От него зависят все поля с std::string_view
-    };
+    // Пакетное удаление документов. Статистика термов и число документов обновляются один раз на пакет,
+    // сегменты проверяются на необходимость вычищения тоже один раз. Отсутствующие id пропускаются
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    // Пакетное удаление документов. Последовательная версия
+    void RemoveDocuments(const std::execution::sequenced_policy&, const std::vector<int>& document_ids);
+
+    // Пакетное удаление документов. Параллельная версия: документы пакета ищутся в сегментах в нескольких потоках
+    void RemoveDocuments(const std::execution::parallel_policy&, const std::vector<int>& document_ids);
+
+    // Количество удаленных документов, вхождения которых еще не вычищены
+    [[nodiscard]] size_t GetDeletedDocumentCount() const;
+
+    // Количество запечатанных сегментов индекса
+    [[nodiscard]] size_t GetSegmentCount() const;
+
+    // Ожидание завершения фоновых слияний сегментов
+    void WaitForMerge();
+
+    // Сохранение текущей версии индекса в файл: стоп-слова, словарь термов, статистика термов
+    // и двоичные представления сегментов. Сегменты с удаленными документами перед записью вычищаются.
+    // Файл пишется во временный файл рядом и затем переименовывается, поэтому прежний файл
+    // по этому пути остается целым при ошибке. При ошибке записи выбрасывается std::runtime_error
+    void SaveSnapshot(const std::string& path) const;
 
-    const std::set<std::string> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::unordered_map<int, std::map<std::string_view, double>> document_to_word_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
+    // Открытие индекса, сохраненного SaveSnapshot. Файл отображается в память, и сегменты со словарем
+    // читаются прямо из него без разбора и копирования; в памяти строится только множество id документов.
+    // Сервер полностью рабочий: новые документы попадают в сегменты в памяти, удаление отмечает документы
+    // в сегментах из файла, слияние переносит их документы в память. Файл нельзя менять, пока он открыт.
+    // Параметры options действуют для документов, добавленных после открытия.
+    // Для файла другого формата или версии выбрасывается std::invalid_argument
+    static SearchServer OpenSnapshot(const std::string& path, const IndexOptions& options = {});
+
+    // Снимок текущей версии индекса. Серия запросов к одному снимку видит одно и то же состояние,
+    // даже если сервер в это время меняется. Запросы к серверу берут новый снимок на каждый вызов
+    [[nodiscard]] std::shared_ptr<const IndexSnapshot> GetSnapshot() const;
+
+    // Память индекса по структурам: списки вхождений, прямой индекс, документы, тексты, словарь и статистика термов
+    [[nodiscard]] MemoryStats GetMemoryStats() const;
+
+    // Счетчики кеша результатов. Если кеш выключен, все счетчики равны нулю
+    [[nodiscard]] ResultCacheStats GetResultCacheStats() const;
 
 private:
-    // Проверка на стоп-слова
-    [[nodiscard]] bool IsStopWord(const std::string& word) const;
+    // Сервер, открытый из файла индекса
+    SearchServer(std::shared_ptr<const MappedFile> file, const IndexOptions& options);
+
+    IndexOptions options_;
+    std::shared_ptr<const StopWordSet> stop_words_;
+    // Общий для всех сегментов и снимков, поэтому id термов в них совпадают
+    std::shared_ptr<TermDictionary> term_dictionary_;
+    TermStatistics term_statistics_;
+    // Сегменты меняются на месте, только если на них нет других ссылок (из снимков, копий сервера, слияния).
+    // Иначе изменяется копия сегмента, которая разделяет с ним документы и списки вхождений
+    std::vector<std::shared_ptr<IndexSegment>> sealed_segments_;
+    std::shared_ptr<IndexSegment> write_segment_;   // Сюда добавляются новые документы
+    DocumentIdSet document_ids_;
+
+    // Фоновое слияние: сливаемые сегменты и будущий результат.
+    // Результат подменяет входные сегменты при следующем изменении сервера.
+    // Документы, удаленные во время слияния, удаляются и из его результата
+    std::vector<std::shared_ptr<IndexSegment>> merge_inputs_;
+    std::shared_future<std::shared_ptr<IndexSegment>> pending_merge_;
+    std::vector<int> removed_during_merge_;
+
+    // Изменения сервера и построение снимка выполняются под write_mutex_.
+    // Запросы берут готовый снимок под snapshot_mutex_ и не ждут писателей, если снимок актуален
+    mutable std::mutex write_mutex_;
+    std::atomic<uint64_t> version_ = 0;     // Номер версии индекса, растет с каждым изменением
+    // Номер версии содержимого: растет только при добавлении и удалении документов. Слияние сегментов
+    // меняет version_, но не результаты запросов, поэтому содержимое не меняет. Меняется под write_mutex_
+    uint64_t content_version_ = 0;
+    mutable std::mutex snapshot_mutex_;
+    mutable std::shared_ptr<const IndexSnapshot> snapshot_;
+    mutable uint64_t snapshot_version_ = 0;
+    // Результаты поиска по статусу, помеченные версией содержимого. Добавление и удаление документов
+    // увеличивает content_version_ и тем самым делает недействительными все сохраненные результаты
+    std::shared_ptr<ResultCache> result_cache_;
 
-    // Проверка на наличие в слове спец-символов
-    static bool IsValidWord(std::string_view word);
+private:
+    // Проверка на стоп-слова
+    [[nodiscard]] bool IsStopWord(std::string_view word) const;
 
-    // Разделяет строку на отдельные слова и возвращает их в векторе, исключая стоп-слова
-    [[nodiscard]] std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+    // Разделяет строку на отдельные слова и записывает их в words, исключая стоп-слова
+    void SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const;
 
     // Вычисление среднего рейтинга
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
-    struct QueryWord {
-        std::string_view data;
-        bool is_minus{};
-        bool is_stop{};
+    // Кеш результатов по параметрам индекса или nullptr, если кеш выключен
+    static std::shared_ptr<ResultCache> MakeResultCache(const IndexOptions& options);
+
+    // Положение документа в индексе: сегмент и номер документа в нем
+    struct DocumentLocation {
+        const IndexSegment* segment;
+        size_t segment_index;   // Индекс в sealed_segments_, для сегмента записи равен sealed_segments_.size()
+        DocumentOrdinal ordinal;
     };
 
-    [[nodiscard]] QueryWord ParseQueryWord(std::string_view text) const;
+    [[nodiscard]] std::optional<DocumentLocation> FindDocumentLocation(int document_id) const;
 
-    struct Query {
-        std::set<std::string_view> plus_words;
-        std::set<std::string_view> minus_words;
-    };
+    // Сегмент для изменения. Если на сегмент есть другие ссылки, он сначала копируется
+    static IndexSegment& DetachSegment(std::shared_ptr<IndexSegment>& segment);
 
-    [[nodiscard]] Query ParseQuery(std::string_view text) const;
+    // Запечатывание заполненного сегмента записи и запуск слияния, если оно нужно
+    void SealWriteSegment();
 
-    // Existence required
-    [[nodiscard]] double ComputeWordInverseDocumentFreq(std::string_view word) const;
+    // Подмена входных сегментов результатом слияния. Если wait == false, незавершенное слияние не ожидается
+    void InstallMerge(bool wait);
 
-    // Поиск по запросу
-    template <typename DocumentPredicate>
-    [[nodiscard]] std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    // Запуск фонового слияния MERGE_FACTOR сегментов одного уровня
+    // или одного сегмента с большой долей удаленных документов
+    void StartMergeIfNeeded();
 
-    // Поиск по запросу. Последовательная версия
-    template <typename DocumentPredicate>
-    [[nodiscard]] std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, DocumentPredicate document_predicate) const;
+    void StartMerge(std::vector<std::shared_ptr<IndexSegment>> segments);
 
-    // Поиск по запросу. Параллельная версия
-    template <typename DocumentPredicate>
-    [[nodiscard]] std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query, DocumentPredicate document_predicate) const;
+    // Удаление документа: документ отмечается удаленным в своем сегменте
+    void RemoveDocumentFromSegment(int document_id);
+
+    // Пакетное удаление документов из содержащих их сегментов
+    template <typename ExecutionPolicy>
+    void RemoveDocumentsFromSegments(ExecutionPolicy&& policy, const std::vector<int>& document_ids);
+
+    // Отметка документа удаленным в его сегменте. Статистику и версию индекса обновляет вызывающий
+    void MarkDocumentRemoved(int document_id, const DocumentLocation& location);
+
+    // Обслуживание сегментов после удаления: пустые сегменты отбрасываются, заполненные удаленными вычищаются
+    void MaintainSegmentsAfterRemoval();
+
+    // Слияние сегмента записи с самим собой, если в нем слишком много удаленных документов.
+    // Сегмент записи небольшой, поэтому это делается сразу
+    void CompactWriteSegmentIfNeeded();
+
+    // Проверка id документов пакета: id неотрицательны и не повторяются ни в пакете, ни на сервере
+    void CheckNewDocumentIds(const std::vector<NewDocument>& documents) const;
+
+    // Разобранный документ пакета: различные слова в алфавитном порядке с числом вхождений,
+    // затем id их термов и частоты
+    struct PreparedDocument {
+        std::vector<std::string_view> words;
+        std::vector<uint32_t> word_counts;
+        std::vector<TermId> term_ids;
+        std::vector<double> term_freqs;
+    };
+
+    // Разбор текста документа пакета. Словарь не нужен, поэтому разбор идет без блокировки
+    [[nodiscard]] PreparedDocument PrepareDocument(std::string_view text) const;
+
+    // Получение id термов разобранного документа, новые слова добавляются в словарь
+    void InternWords(PreparedDocument& document);
+
+    // Упорядочивание термов разобранного документа по id, как в прямом индексе сегмента, и подсчет частот
+    static void SortByTermId(PreparedDocument& document);
+
+    // Построение сегмента из документов пакета или, для пакета меньше WRITE_SEGMENT_CAPACITY, добавление
+    // в записываемый сегмент. Блокировка записи берется только для проверки id, добавления термов в словарь
+    // и установки документов
+    template <typename ExecutionPolicy>
+    void AddDocumentsToSegments(ExecutionPolicy&& policy, const std::vector<NewDocument>& documents);
 };
 
 // Вспомогательные функции для обработки исключений
@@ -155,147 +391,179 @@ void MatchDocuments(const SearchServer& search_server, const std::string& query)
 // Реализация шаблонных методов
 // Конструктор инициализирующий сервер стоп-словами из контейнера
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-        : stop_words_(MakeUniqueNonEmptyStrings(stop_words))  // Extract non-empty stop words
+SearchServer::SearchServer(const StringContainer& stop_words, const IndexOptions& options)
+        : options_(options)
+        , stop_words_(std::make_shared<const StopWordSet>(MakeUniqueNonEmptyStrings(stop_words)))  // Extract non-empty stop words
+        , term_dictionary_(std::make_shared<TermDictionary>())
+        , write_segment_(std::make_shared<IndexSegment>())
+        , result_cache_(MakeResultCache(options))
 {
-    if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+    if (!all_of(stop_words_->begin(), stop_words_->end(), IsValidWord)) {
         throw std::invalid_argument("Some of stop words are invalid");
     }
 }
 
 // Поиск наиболее релевантных документов по предикату
 template <typename DocumentPredicate>
-[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
-    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                                   const SearchOptions& options) const {
+    return GetSnapshot()->FindTopDocuments(raw_query, document_predicate, options);
 }
 
 // Поиск наиболее релевантных документов по предикату. Последовательная версия
 template <typename DocumentPredicate>
 [[nodiscard]] std::vector<Document>
-SearchServer::FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentPredicate document_predicate) const {
-    //LOG_DURATION_STREAM("Operation time", std::cout);
-    const Query query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
-        }
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;
+SearchServer::FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentPredicate document_predicate,
+                               const SearchOptions& options) const {
+    return GetSnapshot()->FindTopDocuments(std::execution::seq, raw_query, document_predicate, options);
 }
 
 // Поиск наиболее релевантных документов по предикату. Параллельная версия
 template <typename DocumentPredicate>
 [[nodiscard]] std::vector<Document>
-SearchServer::FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentPredicate document_predicate) const {
-    //LOG_DURATION_STREAM("Operation time", std::cout);
-    const Query query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(std::execution::par, query, document_predicate);
-
-    sort(std::execution::par, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
-        }
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;
+SearchServer::FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentPredicate document_predicate,
+                               const SearchOptions& options) const {
+    return GetSnapshot()->FindTopDocuments(std::execution::par, raw_query, document_predicate, options);
 }
 
+// Поиск по подготовленному запросу по предикату
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate,
+                                                                   const SearchOptions& options) const {
+    return GetSnapshot()->FindTopDocuments(query, document_predicate, options);
+}
 
-// Поиск по запросу
+// Поиск по подготовленному запросу по предикату. Последовательная версия
 template <typename DocumentPredicate>
-[[nodiscard]] std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    return FindAllDocuments(std::execution::seq, query, document_predicate);
+[[nodiscard]] std::vector<Document>
+SearchServer::FindTopDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, DocumentPredicate document_predicate,
+                               const SearchOptions& options) const {
+    return GetSnapshot()->FindTopDocuments(std::execution::seq, query, document_predicate, options);
 }
 
-// Поиск по запросу. Последовательная версия
+// Поиск по подготовленному запросу по предикату. Параллельная версия
 template <typename DocumentPredicate>
 [[nodiscard]] std::vector<Document>
-SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (std::string_view word : query.plus_words) {
-        auto found_documents = word_to_document_freqs_.find(word);
-        if (found_documents == word_to_document_freqs_.end()) {
-            continue;
+SearchServer::FindTopDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, DocumentPredicate document_predicate,
+                               const SearchOptions& options) const {
+    return GetSnapshot()->FindTopDocuments(std::execution::par, query, document_predicate, options);
+}
+
+// Построение сегмента из документов пакета
+template <typename ExecutionPolicy>
+void SearchServer::AddDocumentsToSegments(ExecutionPolicy&& policy, const std::vector<NewDocument>& documents) {
+    if (documents.empty()) {
+        return;
+    }
+    // Разбор текстов не меняет данных сервера, поэтому идет без блокировки. Исключения не должны
+    // покидать параллельный алгоритм, поэтому они сохраняются и выбрасывается первое по порядку документов
+    std::vector<PreparedDocument> prepared(documents.size());
+    std::vector<std::exception_ptr> errors(documents.size());
+    std::vector<size_t> indexes(documents.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(policy, indexes.begin(), indexes.end(), [&](size_t index) {
+        try {
+            prepared[index] = PrepareDocument(documents[index].text);
+        } catch (...) {
+            errors[index] = std::current_exception();
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : found_documents->second) {
-            if (document_predicate(document_id, documents_.at(document_id).status, documents_.at(document_id).rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
-            }
+    });
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
         }
     }
 
-    for (std::string_view word : query.minus_words) {
-        auto found_documents = word_to_document_freqs_.find(word);
-        if (found_documents == word_to_document_freqs_.end()) {
-            continue;
-        }
-        for (const auto [document_id, _] : found_documents->second) {
-            document_to_relevance.erase(document_id);
+    {
+        std::lock_guard guard(write_mutex_);
+        CheckNewDocumentIds(documents);
+        // Новые термы добавляются в словарь по порядку документов, поэтому их id не зависят от числа потоков
+        for (PreparedDocument& document : prepared) {
+            InternWords(document);
         }
     }
 
-    std::vector<Document> matched_documents;
-    matched_documents.reserve(document_to_relevance.size());
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.emplace_back(document_id, relevance, documents_.at(document_id).rating);
+    // Крупный пакет становится одним запечатанным сегментом. Сегмент еще не виден ни запросам,
+    // ни другим операциям записи, поэтому строится без блокировки
+    std::for_each(policy, prepared.begin(), prepared.end(), [](PreparedDocument& document) {
+        SortByTermId(document);
+    });
+    std::vector<DocumentView> views;
+    views.reserve(documents.size());
+    for (size_t index = 0; index < documents.size(); ++index) {
+        const NewDocument& document = documents[index];
+        views.push_back({{document.id, ComputeAverageRating(document.ratings), document.status},
+                         options_.store_document_text ? document.text : std::string_view{},
+                         {prepared[index].term_ids, prepared[index].term_freqs}});
+    }
+    // Пакет меньше записываемого сегмента дописывается в записываемый сегмент, иначе мелкие пакеты
+    // плодили бы мелкие сегменты и лишние слияния
+    std::shared_ptr<IndexSegment> segment;
+    std::vector<std::pair<TermId, uint32_t>> document_freqs;
+    if (documents.size() >= WRITE_SEGMENT_CAPACITY) {
+        segment = std::make_shared<IndexSegment>(IndexSegment::Build(views));
+        // Документная частота терма в пакете - длина его списка вхождений
+        for (TermId term_id = 0; term_id < segment->GetTermCount(); ++term_id) {
+            if (const size_t document_freq = segment->GetPostings(term_id).size(); document_freq > 0) {
+                document_freqs.emplace_back(term_id, static_cast<uint32_t>(document_freq));
+            }
+        }
     }
-    return matched_documents;
-}
 
-// Поиск по запросу. Параллельная версия
-template <typename DocumentPredicate>
-[[nodiscard]] std::vector<Document>
-SearchServer::FindAllDocuments(const std::execution::parallel_policy&, const Query& query, DocumentPredicate document_predicate) const {
-    ConcurrentMap<int, double> document_to_relevance(64);
-    std::for_each(
-        std::execution::par,
-        query.plus_words.begin(), query.plus_words.end(),
-        [this, document_predicate, &document_to_relevance](std::string_view word) {
-            auto found_documents = word_to_document_freqs_.find(word);
-            if (found_documents == word_to_document_freqs_.end()) {
-                return;
+    std::lock_guard guard(write_mutex_);
+    // Пока пакет разбирался, документы с теми же id могли добавить другие операции записи
+    CheckNewDocumentIds(documents);
+    if (segment) {
+        for (const auto& [term_id, document_freq] : document_freqs) {
+            term_statistics_.AddTerm(term_id, document_freq);
+        }
+        sealed_segments_.push_back(std::move(segment));
+    } else {
+        for (const DocumentView& view : views) {
+            for (const TermId term_id : view.word_freqs.term_ids) {
+                term_statistics_.AddTerm(term_id);
             }
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : found_documents->second) {
-                if (document_predicate(document_id, documents_.at(document_id).status, documents_.at(document_id).rating)) {
-                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                }
+            DetachSegment(write_segment_).AddDocument(view);
+            if (write_segment_->GetOrdinalCount() >= WRITE_SEGMENT_CAPACITY) {
+                SealWriteSegment();
             }
+        }
+    }
+    for (const NewDocument& document : documents) {
+        document_ids_.insert(document.id);
+    }
+    term_statistics_.SetDocumentCount(document_ids_.size());
+    ++version_;
+    ++content_version_;
+    InstallMerge(false);
+    StartMergeIfNeeded();
+}
 
-        });
-
-    //
-
-    std::for_each(
-            std::execution::par,
-            query.minus_words.begin(), query.minus_words.end(),
-            [this, &document_to_relevance](std::string_view word) {
-                auto found_documents = word_to_document_freqs_.find(word);
-                if (found_documents == word_to_document_freqs_.end()) {
-                    return;
-                }
-                for (const auto [document_id, _] : found_documents->second) {
-                    document_to_relevance.Erase(document_id);
-                }
-            });
-
-    std::map<int, double> ordinary_map = document_to_relevance.BuildOrdinaryMap();
-    std::vector<Document> matched_documents;
-    matched_documents.reserve(ordinary_map.size());
-    for (const auto [document_id, relevance] : ordinary_map) {
-        matched_documents.emplace_back(document_id, relevance, documents_.at(document_id).rating);
+// Пакетное удаление документов из содержащих их сегментов
+template <typename ExecutionPolicy>
+void SearchServer::RemoveDocumentsFromSegments(ExecutionPolicy&& policy, const std::vector<int>& document_ids) {
+    std::lock_guard guard(write_mutex_);
+    // Поиск только читает сегменты, поэтому выполняется параллельно
+    std::vector<std::optional<DocumentLocation>> locations(document_ids.size());
+    std::transform(policy, document_ids.begin(), document_ids.end(), locations.begin(),
+                   [this](int document_id) {
+                       return FindDocumentLocation(document_id);
+                   });
+
+    bool removed = false;
+    for (size_t i = 0; i < document_ids.size(); ++i) {
+        // Повторный id в пакете уже удален
+        if (!locations[i] || document_ids_.count(document_ids[i]) == 0) {
+            continue;
+        }
+        MarkDocumentRemoved(document_ids[i], *locations[i]);
+        removed = true;
     }
-    return matched_documents;
-}
\ No newline at end of file
+    if (!removed) {
+        return;
+    }
+    term_statistics_.SetDocumentCount(document_ids_.size());
+    ++version_;
+    ++content_version_;
+    MaintainSegmentsAfterRemoval();
+}
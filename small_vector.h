@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// Вектор, который хранит первые N элементов внутри объекта и выделяет память только при переполнении.
+// Подходит для коротких списков, которые создаются на каждый запрос, например слов запроса.
+// Только для тривиально копируемых элементов: элементы копируются как байты
+template <typename T, size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector хранит только тривиально копируемые элементы");
+
+public:
+    using value_type = T;
+
+    SmallVector() = default;
+
+    SmallVector(const SmallVector& other) {
+        *this = other;
+    }
+
+    SmallVector(SmallVector&& other) noexcept
+            : inline_(other.inline_)
+            , heap_(std::move(other.heap_))
+            , size_(other.size_) {
+        other.heap_.clear();
+        other.size_ = 0;
+    }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) {
+            clear();
+            reserve(other.size_);
+            std::copy(other.begin(), other.end(), begin());
+            size_ = other.size_;
+        }
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            inline_ = other.inline_;
+            heap_ = std::move(other.heap_);
+            size_ = other.size_;
+            other.heap_.clear();
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    void push_back(const T& value) {
+        if (size_ == capacity()) {
+            reserve(size_ + 1);
+        }
+        data()[size_++] = value;
+    }
+
+    // Новые элементы инициализируются значением по умолчанию
+    void resize(size_t size) {
+        reserve(size);
+        if (size > size_) {
+            std::fill(data() + size_, data() + size, T{});
+        }
+        size_ = size;
+    }
+
+    // Удаляет элементы [first, last), сдвигая следующие за ними
+    void erase(const T* first, const T* last) {
+        T* erase_begin = begin() + (first - begin());
+        const T* erase_end = begin() + (last - begin());
+        size_ = std::copy(erase_end, static_cast<const T*>(end()), erase_begin) - begin();
+    }
+
+    void clear() {
+        size_ = 0;
+    }
+
+    // Место во внутреннем буфере не освобождается, выделенное в куче - сохраняется до уничтожения
+    void reserve(size_t capacity) {
+        if (capacity <= this->capacity()) {
+            return;
+        }
+        std::vector<T> heap(std::max(capacity, this->capacity() * 2));
+        std::copy(begin(), end(), heap.begin());
+        heap_ = std::move(heap);
+    }
+
+    [[nodiscard]] T* data() {
+        return heap_.empty() ? inline_.data() : heap_.data();
+    }
+
+    [[nodiscard]] const T* data() const {
+        return heap_.empty() ? inline_.data() : heap_.data();
+    }
+
+    [[nodiscard]] T* begin() {
+        return data();
+    }
+
+    [[nodiscard]] T* end() {
+        return data() + size_;
+    }
+
+    [[nodiscard]] const T* begin() const {
+        return data();
+    }
+
+    [[nodiscard]] const T* end() const {
+        return data() + size_;
+    }
+
+    [[nodiscard]] T& operator[](size_t index) {
+        assert(index < size_);
+        return data()[index];
+    }
+
+    [[nodiscard]] const T& operator[](size_t index) const {
+        assert(index < size_);
+        return data()[index];
+    }
+
+    [[nodiscard]] size_t size() const {
+        return size_;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return size_ == 0;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+        return heap_.empty() ? N : heap_.size();
+    }
+
+private:
+    std::array<T, N> inline_{};
+    std::vector<T> heap_;   // Используется как буфер размера capacity(), когда элементы не помещаются в inline_
+    size_t size_ = 0;
+};
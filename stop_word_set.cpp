@@ -0,0 +1,59 @@
+#include "stop_word_set.h"
+
+#include <functional>
+
+#include "memory_tracking.h"
+
+StopWordSet::StopWordSet(const std::set<std::string>& words) {
+    size_t chars_size = 0;
+    for (const std::string& word : words) {
+        chars_size += word.size();
+    }
+    chars_.reserve(chars_size);
+    for (const std::string& word : words) {
+        chars_ += word;
+    }
+    // Строка больше не растет, поэтому слова можно ссылать на нее
+    words_.reserve(words.size());
+    size_t offset = 0;
+    for (const std::string& word : words) {
+        words_.emplace_back(chars_.data() + offset, word.size());
+        offset += word.size();
+    }
+
+    if (words_.empty()) {
+        return;
+    }
+    size_t slot_count = 1;
+    while (slot_count < words_.size() * 2) {
+        slot_count *= 2;
+    }
+    slots_.assign(slot_count, 0);
+    for (size_t index = 0; index < words_.size(); ++index) {
+        size_t slot = GetSlot(words_[index]);
+        while (slots_[slot] != 0) {
+            slot = (slot + 1) & (slots_.size() - 1);
+        }
+        slots_[slot] = static_cast<uint32_t>(index + 1);
+    }
+}
+
+bool StopWordSet::Contains(std::string_view word) const {
+    if (slots_.empty()) {
+        return false;
+    }
+    for (size_t slot = GetSlot(word); slots_[slot] != 0; slot = (slot + 1) & (slots_.size() - 1)) {
+        if (words_[slots_[slot] - 1] == word) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t StopWordSet::GetAllocatedBytes() const {
+    return GetHeapBytes(chars_) + words_.capacity() * sizeof(std::string_view) + slots_.capacity() * sizeof(uint32_t);
+}
+
+size_t StopWordSet::GetSlot(std::string_view word) const {
+    return std::hash<std::string_view>{}(word) & (slots_.size() - 1);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Множество стоп-слов, которое проверяется по std::string_view без выделения памяти.
+// Слова копируются подряд в одну строку, а поиск идет по хеш-таблице с открытой адресацией
+// и линейным пробированием. Таблица строится один раз и заполнена не больше чем наполовину,
+// поэтому проверка слова - вычисление хеша и в среднем одно-два сравнения
+class StopWordSet {
+public:
+    using const_iterator = std::vector<std::string_view>::const_iterator;
+
+    StopWordSet() = default;
+
+    // Множество из уникальных непустых слов
+    explicit StopWordSet(const std::set<std::string>& words);
+
+    // Слова ссылаются на собственную строку множества, поэтому множество не копируется и не перемещается
+    StopWordSet(const StopWordSet&) = delete;
+    StopWordSet& operator=(const StopWordSet&) = delete;
+
+    [[nodiscard]] bool Contains(std::string_view word) const;
+
+    // Обход слов в алфавитном порядке
+    [[nodiscard]] const_iterator begin() const {
+        return words_.begin();
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return words_.end();
+    }
+
+    [[nodiscard]] size_t size() const {
+        return words_.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return words_.empty();
+    }
+
+    // Память, выделенная под слова и таблицу
+    [[nodiscard]] size_t GetAllocatedBytes() const;
+
+private:
+    std::string chars_;
+    std::vector<std::string_view> words_;
+    // Номер слова в words_, увеличенный на 1. Ноль - пустая ячейка. Размер - степень двойки
+    std::vector<uint32_t> slots_;
+
+    [[nodiscard]] size_t GetSlot(std::string_view word) const;
+};
@@ -1,18 +1,165 @@
 #include "string_processing.h"
 
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define SEARCH_SERVER_X86_SIMD
+#include <immintrin.h>
+#endif
+
 using std::string;
 
-// Разделяет строку на отдельные слова и возвращает их в векторе
-std::vector<std::string_view> SplitIntoWords(std::string_view str) {
-    std::vector<std::string_view> result;
-    const int64_t pos_end = std::string_view::npos;
-    while (true) {
-        int64_t space = str.find(' ');
-        result.push_back(str.substr(0, space));
-        str.remove_prefix(space + 1);
-        if (space == pos_end) {
+namespace {
+
+bool IsSpecialChar(char c) {
+    return c >= '\0' && c < ' ';
+}
+
+// Функции ниже обрабатывают строку целыми блоками и возвращают длину обработанной части.
+// Остаток строки короче блока дорабатывается без SIMD
+using SplitBlocksFunction = size_t (*)(std::string_view str, size_t& word_begin, std::vector<std::string_view>& words,
+                                       bool& has_special);
+using FindSpecialBlocksFunction = size_t (*)(std::string_view str, bool& has_special);
+
+size_t SplitBlocksScalar(std::string_view, size_t&, std::vector<std::string_view>&, bool&) {
+    return 0;
+}
+
+size_t FindSpecialBlocksScalar(std::string_view, bool&) {
+    return 0;
+}
+
+#ifdef SEARCH_SERVER_X86_SIMD
+// Спец-символы - байты от 0 до 31. Байты от 128 при знаковом сравнении отрицательны и допустимы
+
+// Добавляет слова, которые заканчиваются пробелами блока. Бит i маски - пробел в позиции block_pos + i
+void AppendWords(std::string_view str, size_t block_pos, uint32_t space_mask, size_t& word_begin,
+                 std::vector<std::string_view>& words) {
+    while (space_mask != 0) {
+        const size_t pos = block_pos + __builtin_ctz(space_mask);
+        words.push_back(str.substr(word_begin, pos - word_begin));
+        word_begin = pos + 1;
+        space_mask &= space_mask - 1;
+    }
+}
+
+size_t SplitBlocksSse2(std::string_view str, size_t& word_begin, std::vector<std::string_view>& words, bool& has_special) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i minus_one = _mm_set1_epi8(-1);
+    __m128i special = _mm_setzero_si128();
+    size_t pos = 0;
+    for (; pos + 16 <= str.size(); pos += 16) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str.data() + pos));
+        special = _mm_or_si128(special, _mm_and_si128(_mm_cmplt_epi8(chars, space), _mm_cmpgt_epi8(chars, minus_one)));
+        AppendWords(str, pos, static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chars, space))), word_begin, words);
+    }
+    has_special = has_special || _mm_movemask_epi8(special) != 0;
+    return pos;
+}
+
+size_t FindSpecialBlocksSse2(std::string_view str, bool& has_special) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i minus_one = _mm_set1_epi8(-1);
+    size_t pos = 0;
+    for (; pos + 16 <= str.size(); pos += 16) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str.data() + pos));
+        if (_mm_movemask_epi8(_mm_and_si128(_mm_cmplt_epi8(chars, space), _mm_cmpgt_epi8(chars, minus_one))) != 0) {
+            has_special = true;
+            break;
+        }
+    }
+    return pos;
+}
+
+__attribute__((target("avx2")))
+size_t SplitBlocksAvx2(std::string_view str, size_t& word_begin, std::vector<std::string_view>& words, bool& has_special) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i minus_one = _mm256_set1_epi8(-1);
+    __m256i special = _mm256_setzero_si256();
+    size_t pos = 0;
+    for (; pos + 32 <= str.size(); pos += 32) {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str.data() + pos));
+        special = _mm256_or_si256(special, _mm256_and_si256(_mm256_cmpgt_epi8(space, chars), _mm256_cmpgt_epi8(chars, minus_one)));
+        AppendWords(str, pos, static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, space))), word_begin, words);
+    }
+    has_special = has_special || _mm256_movemask_epi8(special) != 0;
+    return pos;
+}
+
+__attribute__((target("avx2")))
+size_t FindSpecialBlocksAvx2(std::string_view str, bool& has_special) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i minus_one = _mm256_set1_epi8(-1);
+    size_t pos = 0;
+    for (; pos + 32 <= str.size(); pos += 32) {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str.data() + pos));
+        if (_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpgt_epi8(space, chars), _mm256_cmpgt_epi8(chars, minus_one))) != 0) {
+            has_special = true;
             break;
         }
     }
+    return pos;
+}
+#endif
+
+// Набор инструкций выбирается один раз, по возможностям процессора, на котором запущен сервер
+struct BlockFunctions {
+    SplitBlocksFunction split = SplitBlocksScalar;
+    FindSpecialBlocksFunction find_special = FindSpecialBlocksScalar;
+};
+
+BlockFunctions ChooseBlockFunctions() {
+    BlockFunctions functions;
+#ifdef SEARCH_SERVER_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        functions.split = SplitBlocksAvx2;
+        functions.find_special = FindSpecialBlocksAvx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        functions.split = SplitBlocksSse2;
+        functions.find_special = FindSpecialBlocksSse2;
+    }
+#endif
+    return functions;
+}
+
+const BlockFunctions& GetBlockFunctions() {
+    static const BlockFunctions functions = ChooseBlockFunctions();
+    return functions;
+}
+
+}  // namespace
+
+bool SplitIntoWords(std::string_view str, std::vector<std::string_view>& words) {
+    words.clear();
+    size_t word_begin = 0;
+    bool has_special = false;
+    size_t pos = GetBlockFunctions().split(str, word_begin, words, has_special);
+    for (; pos < str.size(); ++pos) {
+        const char c = str[pos];
+        if (c == ' ') {
+            words.push_back(str.substr(word_begin, pos - word_begin));
+            word_begin = pos + 1;
+        } else if (IsSpecialChar(c)) {
+            has_special = true;
+        }
+    }
+    words.push_back(str.substr(word_begin));
+    return !has_special;
+}
+
+// Разделяет строку на отдельные слова и возвращает их в векторе
+std::vector<std::string_view> SplitIntoWords(std::string_view str) {
+    std::vector<std::string_view> result;
+    SplitIntoWords(str, result);
     return result;
 }
+
+// Проверка на наличие в слове спец-символов
+bool IsValidWord(std::string_view word) {
+    // A valid word must not contain special characters
+    bool has_special = false;
+    const size_t pos = GetBlockFunctions().find_special(word, has_special);
+    return !has_special && std::none_of(word.begin() + pos, word.end(), IsSpecialChar);
+}
@@ -2,11 +2,21 @@
 
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 // Разделяет строку на отдельные слова и возвращает их в векторе
 std::vector<std::string_view> SplitIntoWords(std::string_view str);
 
+// Разделяет строку на слова по пробелам и записывает их в words вместо прежнего содержимого,
+// поэтому память буфера переиспользуется между вызовами. Строка просматривается один раз вместе
+// с проверкой на спец-символы (коды от 0 до 31) блоками по 32 (AVX2) или 16 (SSE2) байт, если процессор
+// их поддерживает. Возвращает false, если в строке есть спец-символы; слова при этом все равно записываются
+bool SplitIntoWords(std::string_view str, std::vector<std::string_view>& words);
+
+// Проверка на наличие в слове спец-символов
+bool IsValidWord(std::string_view word);
+
 template <typename StringContainer>
 std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
     std::set<std::string> non_empty_strings;
@@ -0,0 +1,146 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+
+#include "binary_io.h"
+
+TermDictionary::TermDictionary(const TermDictionary& other) {
+    std::shared_lock guard(other.mutex_);
+    // Термы из файла неизменяемы, поэтому разделяются с копируемым словарем
+    storage_ = other.storage_;
+    base_offsets_ = other.base_offsets_;
+    base_chars_ = other.base_chars_;
+    base_sorted_ids_ = other.base_sorted_ids_;
+    terms_ = other.terms_;
+    // Ключи должны ссылаться на строки этого словаря, а не копируемого
+    term_to_id_.reserve(terms_.size());
+    for (size_t index = 0; index < terms_.size(); ++index) {
+        term_to_id_.emplace(terms_[index], static_cast<TermId>(GetBaseSize() + index));
+    }
+}
+
+TermDictionary::TermDictionary(std::shared_ptr<const void> storage, ArrayView<char> bytes)
+        : storage_(std::move(storage)) {
+    BinaryReader reader(bytes.data(), bytes.size());
+    const auto term_count = reader.Read<uint64_t>();
+    const auto chars_size = reader.Read<uint64_t>();
+    if (term_count >= std::numeric_limits<TermId>::max()) {
+        throw std::invalid_argument("Двоичные данные словаря повреждены: слишком много термов");
+    }
+    base_offsets_ = reader.ReadArray<uint64_t>(term_count + 1);
+    base_chars_ = reader.ReadArray<char>(chars_size);
+    base_sorted_ids_ = reader.ReadArray<TermId>(term_count);
+    reader.Align();
+    if (!reader.AtEnd() || base_offsets_.front() != 0 || base_offsets_.back() != chars_size
+        || !std::is_sorted(base_offsets_.begin(), base_offsets_.end())
+        || !std::all_of(base_sorted_ids_.begin(), base_sorted_ids_.end(), [term_count](TermId term_id) {
+               return term_id < term_count;
+           })) {
+        throw std::invalid_argument("Двоичные данные словаря повреждены");
+    }
+}
+
+TermId TermDictionary::Intern(std::string_view term) {
+    if (const auto term_id = Find(term)) {
+        return *term_id;
+    }
+    std::unique_lock guard(mutex_);
+    const auto found = term_to_id_.find(term);
+    if (found != term_to_id_.end()) {
+        return found->second;
+    }
+    const auto term_id = static_cast<TermId>(GetBaseSize() + terms_.size());
+    const std::string& stored_term = terms_.emplace_back(term);
+    term_to_id_.emplace(stored_term, term_id);
+    return term_id;
+}
+
+std::optional<TermId> TermDictionary::Find(std::string_view term) const {
+    // Термы из файла не меняются и читаются без блокировки
+    if (const auto term_id = FindBaseTerm(term)) {
+        return term_id;
+    }
+    std::shared_lock guard(mutex_);
+    const auto found = term_to_id_.find(term);
+    if (found == term_to_id_.end()) {
+        return std::nullopt;
+    }
+    return found->second;
+}
+
+std::string_view TermDictionary::GetTerm(TermId term_id) const {
+    if (term_id < GetBaseSize()) {
+        return GetBaseTerm(term_id);
+    }
+    std::shared_lock guard(mutex_);
+    return terms_.at(term_id - GetBaseSize());
+}
+
+size_t TermDictionary::size() const {
+    std::shared_lock guard(mutex_);
+    return GetBaseSize() + terms_.size();
+}
+
+std::vector<char> TermDictionary::Serialize() const {
+    std::shared_lock guard(mutex_);
+    const size_t term_count = GetBaseSize() + terms_.size();
+    std::vector<uint64_t> offsets{0};
+    std::vector<char> chars;
+    offsets.reserve(term_count + 1);
+    for (TermId term_id = 0; term_id < term_count; ++term_id) {
+        const std::string_view term = term_id < GetBaseSize() ? GetBaseTerm(term_id) : terms_[term_id - GetBaseSize()];
+        chars.insert(chars.end(), term.begin(), term.end());
+        offsets.push_back(chars.size());
+    }
+    std::vector<TermId> sorted_ids(term_count);
+    std::iota(sorted_ids.begin(), sorted_ids.end(), 0);
+    const auto get_term = [&offsets, &chars](TermId term_id) {
+        return std::string_view(chars.data() + offsets[term_id], offsets[term_id + 1] - offsets[term_id]);
+    };
+    std::sort(sorted_ids.begin(), sorted_ids.end(), [&get_term](TermId lhs, TermId rhs) {
+        return get_term(lhs) < get_term(rhs);
+    });
+
+    std::vector<char> bytes;
+    BinaryWriter writer(bytes);
+    writer.Write<uint64_t>(term_count);
+    writer.Write<uint64_t>(chars.size());
+    writer.WriteArray<uint64_t>(offsets);
+    writer.WriteArray<char>(chars);
+    writer.WriteArray<TermId>(sorted_ids);
+    writer.Align();
+    return bytes;
+}
+
+void TermDictionary::AddMemoryUsage(MemoryStats& stats) const {
+    std::shared_lock guard(mutex_);
+    const size_t base_bytes = base_offsets_.size() * sizeof(uint64_t) + base_chars_.size()
+                            + base_sorted_ids_.size() * sizeof(TermId);
+    size_t bytes = base_bytes + terms_.get_allocator().GetAllocatedBytes() + term_to_id_.get_allocator().GetAllocatedBytes();
+    for (const std::string& term : terms_) {
+        bytes += GetHeapBytes(term);
+    }
+    stats.term_dictionary.bytes += bytes;
+    stats.term_dictionary.elements += GetBaseSize() + terms_.size();
+    stats.mapped_bytes += base_bytes;
+}
+
+std::string_view TermDictionary::GetBaseTerm(TermId term_id) const {
+    const uint64_t begin = base_offsets_[term_id];
+    return {base_chars_.data() + begin, static_cast<size_t>(base_offsets_[term_id + 1] - begin)};
+}
+
+std::optional<TermId> TermDictionary::FindBaseTerm(std::string_view term) const {
+    const auto found = std::lower_bound(base_sorted_ids_.begin(), base_sorted_ids_.end(), term,
+                                        [this](TermId term_id, std::string_view value) {
+                                            return GetBaseTerm(term_id) < value;
+                                        });
+    if (found == base_sorted_ids_.end() || GetBaseTerm(*found) != term) {
+        return std::nullopt;
+    }
+    return *found;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "array_view.h"
+#include "memory_tracking.h"
+
+using TermId = uint32_t;
+
+// Словарь термов. Каждому терму один раз присваивается плотный id (0, 1, 2, ...),
+// по которому индексируются все внутренние структуры сервера.
+// Словарь владеет строками термов, поэтому возвращаемые std::string_view
+// действительны все время жизни словаря.
+// Термы только добавляются, поэтому читать словарь можно одновременно с добавлением термов.
+// Словарь, прочитанный из файла индекса, ищет термы прямо в отображенном в память файле,
+// а в памяти хранит только термы, добавленные после открытия
+class TermDictionary {
+public:
+    TermDictionary() = default;
+    TermDictionary(const TermDictionary& other);
+
+    // Словарь из двоичного представления bytes (см. Serialize). Данные не копируются,
+    // storage владеет памятью bytes. При ошибке в данных выбрасывается std::invalid_argument
+    TermDictionary(std::shared_ptr<const void> storage, ArrayView<char> bytes);
+    TermDictionary& operator=(const TermDictionary&) = delete;
+
+    // Возвращает id терма, добавляя терм в словарь при необходимости
+    TermId Intern(std::string_view term);
+
+    // Возвращает id терма или std::nullopt, если терма нет в словаре
+    [[nodiscard]] std::optional<TermId> Find(std::string_view term) const;
+
+    [[nodiscard]] std::string_view GetTerm(TermId term_id) const;
+
+    [[nodiscard]] size_t size() const;
+
+    // Двоичное представление словаря: все термы в порядке id и id термов в алфавитном порядке
+    [[nodiscard]] std::vector<char> Serialize() const;
+
+    // Учет памяти словаря в статистике по структурам индекса
+    void AddMemoryUsage(MemoryStats& stats) const;
+
+private:
+    // Термы из файла: границы термов в base_chars_ по id и id в алфавитном порядке для двоичного поиска
+    std::shared_ptr<const void> storage_;
+    ArrayView<uint64_t> base_offsets_;
+    ArrayView<char> base_chars_;
+    ArrayView<TermId> base_sorted_ids_;
+
+    // Термы, добавленные в памяти. Их id продолжают id термов из файла
+    std::deque<std::string, TrackingAllocator<std::string>> terms_;  // deque не перемещает строки при добавлении
+    std::unordered_map<std::string_view, TermId, std::hash<std::string_view>, std::equal_to<>,
+                       TrackingAllocator<std::pair<const std::string_view, TermId>>> term_to_id_;
+    mutable std::shared_mutex mutex_;
+
+    [[nodiscard]] size_t GetBaseSize() const {
+        return base_sorted_ids_.size();
+    }
+
+    [[nodiscard]] std::string_view GetBaseTerm(TermId term_id) const;
+
+    [[nodiscard]] std::optional<TermId> FindBaseTerm(std::string_view term) const;
+};
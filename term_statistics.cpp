@@ -0,0 +1,117 @@
+#include "term_statistics.h"
+
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "binary_io.h"
+
+double InverseDocumentFreqs::operator[](TermId term_id) const {
+    const Chunk& chunk = *chunks_[term_id / CHUNK_SIZE];
+    const size_t index = term_id % CHUNK_SIZE;
+    return chunk.document_freqs[index] > 0
+           ? log_document_count_ - chunk.log_document_freqs[index]
+           : 0.0;
+}
+
+TermStatistics::TermStatistics(ArrayView<char> bytes) {
+    BinaryReader reader(bytes.data(), bytes.size());
+    document_count_ = reader.Read<uint64_t>();
+    const auto term_count = reader.Read<uint64_t>();
+    const ArrayView<uint32_t> document_freqs = reader.ReadArray<uint32_t>(term_count);
+    reader.Align();
+    if (!reader.AtEnd()) {
+        throw std::invalid_argument("Двоичные данные статистики термов повреждены");
+    }
+    for (TermId term_id = 0; term_id < term_count; ++term_id) {
+        SetDocumentFreq(term_id, document_freqs[term_id]);
+    }
+}
+
+void TermStatistics::AddTerm(TermId term_id, uint32_t document_count) {
+    SetDocumentFreq(term_id, GetDocumentFreq(term_id) + document_count);
+    ++generation_;
+}
+
+void TermStatistics::RemoveTerm(TermId term_id) {
+    if (term_id >= term_count_) {
+        throw std::out_of_range("Терм без документной частоты");
+    }
+    SetDocumentFreq(term_id, GetDocumentFreq(term_id) - 1);
+    ++generation_;
+}
+
+void TermStatistics::SetDocumentCount(size_t document_count) {
+    document_count_ = document_count;
+    ++generation_;
+}
+
+uint32_t TermStatistics::GetDocumentFreq(TermId term_id) const {
+    return term_id < term_count_
+           ? document_freqs_[term_id / InverseDocumentFreqs::CHUNK_SIZE]->document_freqs[term_id % InverseDocumentFreqs::CHUNK_SIZE]
+           : 0;
+}
+
+std::shared_ptr<const InverseDocumentFreqs> TermStatistics::GetInverseDocumentFreqs() const {
+    // Поколения сдвинуты на 1, чтобы нулевое значение означало "таблица не построена"
+    if (idf_generation_ == generation_ + 1) {
+        return inverse_document_freqs_;
+    }
+    auto inverse_document_freqs = std::make_shared<InverseDocumentFreqs>();
+    inverse_document_freqs->chunks_.assign(document_freqs_.begin(), document_freqs_.end());
+    inverse_document_freqs->term_count_ = term_count_;
+    // Логарифм числа документов считается один раз на версию индекса
+    inverse_document_freqs->log_document_count_ = std::log(static_cast<double>(document_count_));
+    inverse_document_freqs_ = std::move(inverse_document_freqs);
+    idf_generation_ = generation_ + 1;
+    return inverse_document_freqs_;
+}
+
+std::vector<char> TermStatistics::Serialize() const {
+    std::vector<uint32_t> document_freqs;
+    document_freqs.reserve(term_count_);
+    for (TermId term_id = 0; term_id < term_count_; ++term_id) {
+        document_freqs.push_back(GetDocumentFreq(term_id));
+    }
+    std::vector<char> bytes;
+    BinaryWriter writer(bytes);
+    writer.Write<uint64_t>(document_count_);
+    writer.Write<uint64_t>(document_freqs.size());
+    writer.WriteArray<uint32_t>(document_freqs);
+    writer.Align();
+    return bytes;
+}
+
+void TermStatistics::AddMemoryUsage(MemoryStats& stats) const {
+    stats.term_statistics.bytes += document_freqs_.size() * sizeof(Chunk) + document_freqs_.capacity() * sizeof(document_freqs_[0]);
+    if (inverse_document_freqs_) {
+        const auto& chunks = inverse_document_freqs_->chunks_;
+        stats.term_statistics.bytes += chunks.capacity() * sizeof(chunks[0]);
+        // Куски, которые таблица уже не разделяет со статистикой
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            if (chunks[i] != document_freqs_[i]) {
+                stats.term_statistics.bytes += sizeof(Chunk);
+            }
+        }
+    }
+    stats.term_statistics.elements += term_count_;
+}
+
+void TermStatistics::SetDocumentFreq(TermId term_id, uint32_t document_freq) {
+    constexpr size_t CHUNK_SIZE = InverseDocumentFreqs::CHUNK_SIZE;
+    while (term_id / CHUNK_SIZE >= document_freqs_.size()) {
+        document_freqs_.push_back(std::make_shared<Chunk>());
+    }
+    term_count_ = std::max<size_t>(term_count_, term_id + 1);
+    auto& chunk = document_freqs_[term_id / CHUNK_SIZE];
+    if (chunk.use_count() > 1) {
+        chunk = std::make_shared<Chunk>(*chunk);
+    } else {
+        // Последняя чужая ссылка могла быть освобождена в другом потоке
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    // Логарифм считается при изменении частоты, а не при каждом запросе
+    chunk->document_freqs[term_id % CHUNK_SIZE] = document_freq;
+    chunk->log_document_freqs[term_id % CHUNK_SIZE] = document_freq > 0 ? std::log(static_cast<double>(document_freq)) : 0.0;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "array_view.h"
+#include "memory_tracking.h"
+#include "term_dictionary.h"
+
+// Таблица IDF версии индекса, индексируемая id терма. Хранит куски по CHUNK_SIZE термов с документными
+// частотами и их логарифмами, посчитанными при изменении частоты, и логарифм числа документов.
+// IDF = log(N / df) = log(N) - log(df), поэтому запрос не вычисляет логарифмы. Таблица не меняется,
+// а куски, в которых частоты не изменились, разделяет с таблицами других версий
+class InverseDocumentFreqs {
+public:
+    static constexpr size_t CHUNK_SIZE = 512;
+
+    // IDF терма. Для термов без документов IDF равен 0
+    [[nodiscard]] double operator[](TermId term_id) const;
+
+    [[nodiscard]] size_t size() const {
+        return term_count_;
+    }
+
+private:
+    friend class TermStatistics;
+
+    struct Chunk {
+        std::array<uint32_t, CHUNK_SIZE> document_freqs{};
+        std::array<double, CHUNK_SIZE> log_document_freqs{};  // Для термов без документов не используется
+    };
+
+    std::vector<std::shared_ptr<const Chunk>> chunks_;
+    size_t term_count_ = 0;
+    double log_document_count_ = 0.0;
+};
+
+// Статистика термов для ранжирования: документная частота каждого терма и таблица IDF.
+// Документные частоты обновляются при добавлении и удалении документов, а таблица IDF
+// строится лениво - при первом запросе после изменения индекса (смены поколения).
+// Построенная таблица не меняется, поэтому снимки индекса могут хранить ее, пока она им нужна.
+// Таблица разделяет куски документных частот со статистикой: изменение частоты копирует только
+// свой кусок, поэтому построение таблицы стоит O(число кусков), а не O(число термов)
+class TermStatistics {
+public:
+    TermStatistics() = default;
+
+    // Статистика из двоичного представления (см. Serialize). Документные частоты копируются,
+    // потому что меняются при изменении индекса. При ошибке в данных выбрасывается std::invalid_argument
+    explicit TermStatistics(ArrayView<char> bytes);
+
+    // Учет терма добавленных документов, document_count - число документов с этим термом
+    void AddTerm(TermId term_id, uint32_t document_count = 1);
+
+    // Учет терма удаленного документа
+    void RemoveTerm(TermId term_id);
+
+    void SetDocumentCount(size_t document_count);
+
+    [[nodiscard]] uint32_t GetDocumentFreq(TermId term_id) const;
+
+    // Таблица IDF текущей версии
+    [[nodiscard]] std::shared_ptr<const InverseDocumentFreqs> GetInverseDocumentFreqs() const;
+
+    // Двоичное представление: число документов и документные частоты термов
+    [[nodiscard]] std::vector<char> Serialize() const;
+
+    // Учет памяти документных частот и последней построенной таблицы IDF
+    void AddMemoryUsage(MemoryStats& stats) const;
+
+private:
+    using Chunk = InverseDocumentFreqs::Chunk;
+
+    std::vector<std::shared_ptr<Chunk>> document_freqs_;    // Куски частот, копируются при изменении, если их разделяют
+    size_t term_count_ = 0;
+    size_t document_count_ = 0;
+    uint64_t generation_ = 0;
+
+    mutable uint64_t idf_generation_ = 0;
+    mutable std::shared_ptr<const InverseDocumentFreqs> inverse_document_freqs_;
+
+    // Изменение частоты терма вместе с ее логарифмом
+    void SetDocumentFreq(TermId term_id, uint32_t document_freq);
+};
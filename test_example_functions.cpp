@@ -1,9 +1,38 @@
 #include "test_example_functions.h"
 
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <thread>
 #include <vector>
 
 using namespace std::literals;
 
+namespace {
+// Число выделений памяти в текущем потоке. Считается заменой глобального operator new
+thread_local size_t allocation_count = 0;
+}
+
+void* operator new(size_t size) {
+    ++allocation_count;
+    if (void* data = std::malloc(size == 0 ? 1 : size)) {
+        return data;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* data) noexcept {
+    std::free(data);
+}
+
+void operator delete(void* data, size_t) noexcept {
+    std::free(data);
+}
+
 void AssertImpl(bool value, const std::string& expr_str, const std::string& file, const std::string& func, unsigned line,
                 const std::string& hint) {
     using std::cerr;
@@ -36,7 +65,7 @@ void TestAddDocument() {
     // Сначала убеждаемся, что система находит нужный документ
     {
         const std::vector<Document>& found_docs = server.FindTopDocuments("cat"s);
-        ASSERT_EQUAL(found_docs.size(), 1);
+        ASSERT_EQUAL(found_docs.size(), 1u);
         ASSERT_EQUAL(found_docs.at(0).id, 0);
         ASSERT_EQUAL(found_docs.at(0).rating, 2);
     }
@@ -62,7 +91,7 @@ void TestExcludeStopWordsFromAddedDocumentContent() {
         SearchServer server(""sv);
         server.AddDocument(doc_id, content, DocumentStatus::ACTUAL, ratings);
         const auto found_docs = server.FindTopDocuments("in"s);
-        ASSERT_EQUAL(found_docs.size(), 1);
+        ASSERT_EQUAL(found_docs.size(), 1u);
         const Document& doc0 = found_docs[0];
         ASSERT_EQUAL(doc0.id, doc_id);
     }
@@ -90,13 +119,13 @@ void TestMinusWords() {
     // Убеждаемся, что минус слово отсекает второй документ
     {
         const std::vector<Document>& found_docs = server.FindTopDocuments("cat or dog in the -village");
-        ASSERT_EQUAL(found_docs.size(),1);
+        ASSERT_EQUAL(found_docs.size(), 1u);
         ASSERT_EQUAL(found_docs.at(0).id, cat_id);
     }
     // Убеждаемся, что минус слово отсекает первый документ
     {
         const std::vector<Document>& found_docs = server.FindTopDocuments("cat or dog in the -city");
-        ASSERT_EQUAL(found_docs.size(), 1);
+        ASSERT_EQUAL(found_docs.size(), 1u);
         ASSERT_EQUAL(found_docs.at(0).id, dog_id);
     }
 
@@ -109,7 +138,7 @@ void TestMinusWords() {
     // Убеждаемся, что минус слово которого нет в обоих документах не повлияет на результат
     {
         const std::vector<Document>& found_docs = server.FindTopDocuments("-rat in the space");
-        ASSERT_EQUAL(found_docs.size(), 2);
+        ASSERT_EQUAL(found_docs.size(), 2u);
         ASSERT(found_docs.at(0).id == cat_id);
         ASSERT(found_docs.at(1).id == dog_id);
     }
@@ -122,7 +151,7 @@ void TestMatchDocumentStatus(const SearchServer& server, int id, DocumentStatus
     ASSERT_EQUAL(static_cast<int>(status_1), static_cast<int>(status));
 
     const auto [words_2, status_2] = server.MatchDocument(std::execution::par, "cat city -fake", id);
-    ASSERT_EQUAL(words_2.size(), 2);
+    ASSERT_EQUAL(words_2.size(), 2u);
     ASSERT_EQUAL(words_2.at(0), "cat"s);
     ASSERT_EQUAL(words_2.at(1), "city"s);
     ASSERT_EQUAL(static_cast<int>(status_2), static_cast<int>(status));
@@ -183,7 +212,7 @@ void TestRating() {
     ASSERT_EQUAL(server.GetDocumentCount(), 5);
 
     const std::vector<Document>& found_docs = server.FindTopDocuments(query, actual_doc);
-    ASSERT_EQUAL(found_docs.size(), 5);
+    ASSERT_EQUAL(found_docs.size(), 5u);
     ASSERT_EQUAL(found_docs.at(0).rating, 10);
     ASSERT_EQUAL(found_docs.at(1).rating, 3);
     ASSERT_EQUAL(found_docs.at(2).rating, 2);
@@ -206,7 +235,7 @@ void TestFilterPredicate() {
         const std::vector<Document>& found_docs = server.FindTopDocuments(query,
                                                                           [](int document_id, [[maybe_unused]] DocumentStatus st, [[maybe_unused]] int rating) {
                                                                               return document_id % 2 == 0;});
-        ASSERT_EQUAL(found_docs.size(), 1);
+        ASSERT_EQUAL(found_docs.size(), 1u);
         ASSERT_EQUAL(found_docs.at(0).id, 2);
     }
 
@@ -223,7 +252,7 @@ void TestFilterPredicate() {
         const std::vector<Document>& found_docs = server.FindTopDocuments(query,
                                                                           []([[maybe_unused]] int document_id, [[maybe_unused]] DocumentStatus st, int rating)
                                                                           { return rating > 0; });
-        ASSERT_EQUAL(found_docs.size(), 2);
+        ASSERT_EQUAL(found_docs.size(), 2u);
         ASSERT_EQUAL(found_docs.at(0).id, 2);
         ASSERT_EQUAL(found_docs.at(1).id, 1);
     }
@@ -237,7 +266,7 @@ void TestDocumentsWithStatusProcess(const SearchServer& server,
                                     int id,
                                     DocumentStatus status) {
     const auto docs = server.FindTopDocuments(query, status);
-    ASSERT_EQUAL(docs.size(), 1);
+    ASSERT_EQUAL(docs.size(), 1u);
     ASSERT_EQUAL(docs.at(0).id, id);
 }
 
@@ -279,6 +308,456 @@ void TestRelevanceValue() {
         ASSERT(EqualNumbers(found_docs.at(i).relevance, res.at(i), delta));
 }
 
+// Тест списка вхождений: поиск по указателям пропуска в списках незапечатанного и запечатанного сегментов
+void TestPostingList() {
+    // Терм 0 есть в каждом третьем документе: 100 вхождений, полный блок и неполный
+    AppendOnlyPostingList append_only;
+    IndexSegment segment;
+    for (int id = 0; id < 300; ++id) {
+        if (id % 3 == 0) {
+            append_only.Append(static_cast<DocumentOrdinal>(id), 0.5);
+        }
+        segment.AddDocument({id, 0, DocumentStatus::ACTUAL, {}, {{static_cast<TermId>(id % 3 == 0 ? 0 : 1), 0.5}}});
+    }
+
+    const auto check = [](const PostingListView& postings) {
+        ASSERT_EQUAL(postings.size(), 100u);
+        ASSERT(std::is_sorted(postings.GetDocumentOrdinals().begin(), postings.GetDocumentOrdinals().end()));
+        ASSERT(EqualNumbers(postings.GetTermFreqs().back(), 0.5, 1e-6));
+        ASSERT(postings.Contains(3));
+        ASSERT(postings.Contains(297));
+        ASSERT(!postings.Contains(298));
+        ASSERT_EQUAL(postings.Seek(0), 0u);
+        ASSERT_EQUAL(postings.GetDocumentOrdinals()[postings.Seek(200)], 201u);
+        // Поиск за границей полного блока идет по последнему неполному блоку
+        ASSERT_EQUAL(postings.Seek(190), PostingListView::BLOCK_SIZE);
+        ASSERT_EQUAL(postings.Seek(2, 70), 70u);
+        ASSERT_EQUAL(postings.Seek(298), postings.size());
+        ASSERT_EQUAL(postings.Seek(0, 150), postings.size());
+    };
+    check(append_only.View(300));
+    check(segment.GetPostings(0));
+    // Читатель с меньшей границей не видит вхождений документов, добавленных после нее
+    ASSERT_EQUAL(append_only.View(150).size(), 50u);
+    ASSERT_EQUAL(append_only.View(150).Seek(200), 50u);
+
+    segment.Seal();
+    check(segment.GetPostings(0));
+    ASSERT_EQUAL(segment.GetPostings(0).GetBlockLastOrdinals().size(), 2u);
+    ASSERT(segment.GetPostings(2).empty());
+}
+
+// Тест словаря термов: слова остаются доступными после удаления документа, который их добавил
+void TestTermDictionary() {
+    {
+        TermDictionary dictionary;
+        const TermId cat = dictionary.Intern("cat"sv);
+        const TermId dog = dictionary.Intern("dog"sv);
+        ASSERT(cat != dog);
+        ASSERT_EQUAL(dictionary.Intern("cat"s), cat);
+        ASSERT_EQUAL(dictionary.size(), 2u);
+        ASSERT_EQUAL(*dictionary.Find("dog"sv), dog);
+        ASSERT(!dictionary.Find("rat"sv));
+        ASSERT_EQUAL(dictionary.GetTerm(cat), "cat"sv);
+    }
+
+    SearchServer server(""sv);
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat in the village"s, DocumentStatus::ACTUAL, {2});
+    server.RemoveDocument(1);
+
+    const auto word_freqs = server.GetWordFrequencies(2);
+    ASSERT_EQUAL(word_freqs.size(), 4u);
+    ASSERT_EQUAL(word_freqs.begin()->first, "cat"sv);
+    ASSERT_EQUAL(word_freqs.Find("village"sv).value_or(0.0), 0.25);
+    ASSERT(!word_freqs.Find("city"sv));
+    ASSERT(!word_freqs.Find("dog"sv));
+
+    const auto [words, status] = server.MatchDocument("cat city -dog"s, 2);
+    ASSERT_EQUAL(words.size(), 1u);
+    ASSERT_EQUAL(words.at(0), "cat"sv);
+    ASSERT(server.FindTopDocuments("city"s).empty());
+
+    // Полученные частоты остаются действительными после удаления документа
+    server.RemoveDocument(2);
+    ASSERT(server.GetWordFrequencies(2).empty());
+    ASSERT_EQUAL(word_freqs.size(), 4u);
+    ASSERT_EQUAL(word_freqs.begin()->first, "cat"sv);
+}
+
+// Тест выбора top_k документов: размер выдачи задается при вызове, порядок совпадает с полной сортировкой
+void TestTopDocumentsCount() {
+    SearchServer server(""sv);
+    const std::vector<std::string> texts = {"cat"s, "cat dog"s, "cat dog rat"s, "dog"s, "cat city"s, "cat cat dog"s, "rat"s};
+    for (size_t i = 0; i < texts.size(); ++i) {
+        server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 3)});
+    }
+
+    std::vector<Document> expected;
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        const auto found = server.FindTopDocuments("cat dog"s, [id](int document_id, DocumentStatus, int) {
+            return document_id == id;
+        });
+        expected.insert(expected.end(), found.begin(), found.end());
+    }
+    std::sort(expected.begin(), expected.end(), IsMoreRelevant);
+
+    ASSERT(server.FindTopDocuments("cat dog"s, DocumentStatus::ACTUAL, 0).empty());
+    ASSERT_EQUAL(server.FindTopDocuments("cat dog"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    for (size_t top_k : {1, 3, 100}) {
+        const auto seq_docs = server.FindTopDocuments(std::execution::seq, "cat dog"s, DocumentStatus::ACTUAL, top_k);
+        const auto par_docs = server.FindTopDocuments(std::execution::par, "cat dog"s, DocumentStatus::ACTUAL, top_k);
+        ASSERT_EQUAL(seq_docs.size(), std::min(top_k, expected.size()));
+        ASSERT_EQUAL(par_docs.size(), seq_docs.size());
+        for (size_t i = 0; i < seq_docs.size(); ++i) {
+            ASSERT_EQUAL(seq_docs[i].id, expected[i].id);
+            ASSERT_EQUAL(par_docs[i].id, expected[i].id);
+        }
+    }
+
+    // Память под top_k не выделяется заранее, поэтому можно запросить все найденные документы
+    const size_t huge_top_k = std::numeric_limits<size_t>::max();
+    const auto seq_docs = server.FindTopDocuments(std::execution::seq, "cat dog"s, DocumentStatus::ACTUAL, huge_top_k);
+    const auto par_docs = server.FindTopDocuments(std::execution::par, "cat dog"s, DocumentStatus::ACTUAL, huge_top_k);
+    const auto map_docs = server.FindTopDocuments("cat dog"s, DocumentStatus::ACTUAL,
+                                                  SearchOptions(huge_top_k, ScoreAccumulatorType::MAP));
+    ASSERT_EQUAL(seq_docs.size(), expected.size());
+    ASSERT_EQUAL(par_docs.size(), expected.size());
+    ASSERT_EQUAL(map_docs.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL(seq_docs[i].id, expected[i].id);
+        ASSERT_EQUAL(par_docs[i].id, expected[i].id);
+        ASSERT_EQUAL(map_docs[i].id, expected[i].id);
+    }
+}
+
+// Тест удаления документа: номер удаленного документа не переиспользуется, документ остается в сегменте
+// с отметкой об удалении до сжатия или слияния сегмента, но не виден ни поиску, ни MatchDocument
+void TestRemovedDocumentTombstone() {
+    SearchServer server(""sv);
+    server.AddDocument(5, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(7, "dog in the city"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(9, "cat and dog"s, DocumentStatus::BANNED, {3});
+    server.AddDocument(100, "big cat"s, DocumentStatus::ACTUAL, {4});
+    server.RemoveDocument(5);
+    ASSERT_EQUAL(server.GetDocumentCount(), 3);
+    ASSERT_EQUAL(*server.begin(), 7);
+    // Удален один документ из четырех, это не больше доли MAX_DELETED_RATIO, поэтому сегмент не сжимается
+    // и удаленный документ занимает свой номер
+    ASSERT_EQUAL(server.GetDeletedDocumentCount(), 1u);
+
+    // Предикат и выдача оперируют внешними id
+    const auto found_docs = server.FindTopDocuments("cat"s, [](int document_id, DocumentStatus, int) {
+        return document_id > 8;
+    });
+    ASSERT_EQUAL(found_docs.size(), 2u);
+    ASSERT_EQUAL(found_docs.at(0).id, 100);
+    ASSERT_EQUAL(found_docs.at(1).id, 9);
+
+    const auto [words, status] = server.MatchDocument(std::execution::par, "big cat -city"s, 100);
+    ASSERT_EQUAL(words.size(), 2u);
+    ASSERT_EQUAL(static_cast<int>(status), static_cast<int>(DocumentStatus::ACTUAL));
+    ASSERT(server.GetWordFrequencies(5).empty());
+
+    bool thrown = false;
+    try {
+        [[maybe_unused]] const auto result = server.MatchDocument("cat"s, 5);
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+// Тест пересчета IDF после добавления и удаления документов
+void TestInverseDocumentFreqUpdates() {
+    const double delta = 1e-6;
+    SearchServer server(""sv);
+    server.AddDocument(1, "cat city"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "dog city"s, DocumentStatus::ACTUAL, {1});
+    ASSERT(EqualNumbers(server.FindTopDocuments("cat"s).at(0).relevance, 0.5 * std::log(2.0), delta));
+
+    server.AddDocument(3, "rat village"s, DocumentStatus::ACTUAL, {1});
+    ASSERT(EqualNumbers(server.FindTopDocuments("cat"s).at(0).relevance, 0.5 * std::log(3.0), delta));
+    ASSERT(EqualNumbers(server.FindTopDocuments(std::execution::par, "city"s).at(0).relevance, 0.5 * std::log(1.5), delta));
+
+    server.RemoveDocument(2);
+    ASSERT(EqualNumbers(server.FindTopDocuments("city"s).at(0).relevance, 0.5 * std::log(2.0), delta));
+    server.RemoveDocument(std::execution::par, 3);
+    ASSERT(EqualNumbers(server.FindTopDocuments("cat"s).at(0).relevance, 0.0, delta));
+}
+
+// Тест параллельного поиска по диапазонам документов: результаты совпадают с последовательным поиском
+void TestParallelSearchByRanges() {
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 200, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 5'000, 10);
+    SearchServer server(""sv);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 7)});
+    }
+
+    const auto even_ids = [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 0;
+    };
+    std::vector<std::string> queries = {dictionary[1], dictionary[2] + " -"s + dictionary[3]};
+    for (int i = 0; i < 20; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, 5, 0.2));
+    }
+    for (const std::string& query : queries) {
+        const auto seq_docs = server.FindTopDocuments(std::execution::seq, query, even_ids, 20);
+        const auto par_docs = server.FindTopDocuments(std::execution::par, query, even_ids, 20);
+        ASSERT_EQUAL(seq_docs.size(), par_docs.size());
+        for (size_t i = 0; i < seq_docs.size(); ++i) {
+            ASSERT_EQUAL(seq_docs[i].id, par_docs[i].id);
+            ASSERT(EqualNumbers(seq_docs[i].relevance, par_docs[i].relevance, 1e-9));
+        }
+    }
+
+    // Накопитель диапазона индексируется номером относительно начала диапазона и сбрасывается при смене диапазона
+    DenseScoreAccumulator accumulator;
+    accumulator.Reset(1'000, 1'010);
+    accumulator.Exclude(1'003);
+    accumulator.Add(1'009, 0.5);
+    accumulator.Add(1'000, 0.25);
+    accumulator.Add(1'009, 0.5);
+    ASSERT(accumulator.IsExcluded(1'003));
+    ASSERT_EQUAL(accumulator.GetTouched().size(), 2u);
+    ASSERT_EQUAL(accumulator.GetTouched()[0], 1'009u);
+    ASSERT(EqualNumbers(accumulator.GetScore(1'009), 1.0, 1e-12));
+    accumulator.Reset(2'000, 2'010);
+    ASSERT(accumulator.GetTouched().empty());
+    ASSERT(!accumulator.IsExcluded(2'003));
+    ASSERT(EqualNumbers(accumulator.GetScore(2'009), 0.0, 1e-12));
+}
+
+// Тест сегментированного индекса: запечатывание, фоновое слияние и удаление из сегментов
+void TestSegmentedIndex() {
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 18'000, 10);
+    SearchServer server(""sv);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 7)});
+    }
+    // Четыре запечатанных сегмента одного уровня сливаются в один
+    server.WaitForMerge();
+    ASSERT_EQUAL(server.GetSegmentCount(), 1u);
+    ASSERT_EQUAL(server.GetDocumentCount(), 18'000);
+
+    // Удаление из запечатанного сегмента и из сегмента записи
+    const SearchServer copy = server;
+    for (int document_id = 0; document_id < 18'000; document_id += 3) {
+        server.RemoveDocument(document_id);
+    }
+    ASSERT_EQUAL(server.GetDocumentCount(), 12'000);
+    ASSERT_EQUAL(copy.GetDocumentCount(), 18'000);
+    ASSERT(server.GetWordFrequencies(17'997).empty());
+    ASSERT(!copy.GetWordFrequencies(17'997).empty());
+
+    for (int i = 0; i < 20; ++i) {
+        const std::string query = GenerateQuery(generator, dictionary, 5, 0.2);
+        const auto seq_docs = server.FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL, 20);
+        const auto map_docs = server.FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL, {20, ScoreAccumulatorType::MAP});
+        const auto par_docs = server.FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL, 20);
+        ASSERT_EQUAL(seq_docs.size(), par_docs.size());
+        ASSERT_EQUAL(seq_docs.size(), map_docs.size());
+        for (size_t j = 0; j < seq_docs.size(); ++j) {
+            ASSERT(seq_docs[j].id % 3 != 0);
+            ASSERT_EQUAL(seq_docs[j].id, par_docs[j].id);
+            ASSERT_EQUAL(seq_docs[j].id, map_docs[j].id);
+            ASSERT(EqualNumbers(seq_docs[j].relevance, par_docs[j].relevance, 1e-9));
+        }
+    }
+}
+
+void TestCopyDuringMerge() {
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 1'000, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 4 * SearchServer::WRITE_SEGMENT_CAPACITY, 50);
+    SearchServer server(""sv);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+    }
+    // Четвертый сегмент запустил слияние. Удаление до копирования попадает в обе копии,
+    // удаления после копирования - только в свою
+    server.RemoveDocument(1);
+    SearchServer copy = server;
+    const auto copy_snapshot = copy.GetSnapshot();
+    server.RemoveDocument(2);
+    copy.RemoveDocument(3);
+    server.WaitForMerge();
+    copy.WaitForMerge();
+
+    const int document_count = static_cast<int>(documents.size());
+    ASSERT_EQUAL(server.GetDocumentCount(), document_count - 2);
+    ASSERT_EQUAL(copy.GetDocumentCount(), document_count - 2);
+    ASSERT(server.GetWordFrequencies(1).empty());
+    ASSERT(server.GetWordFrequencies(2).empty());
+    ASSERT(!server.GetWordFrequencies(3).empty());
+    ASSERT(copy.GetWordFrequencies(1).empty());
+    ASSERT(!copy.GetWordFrequencies(2).empty());
+    ASSERT(copy.GetWordFrequencies(3).empty());
+    ASSERT(!copy_snapshot->GetWordFrequencies(3).empty());
+    ASSERT_EQUAL(copy_snapshot->GetDocumentCount(), document_count - 1);
+
+    // Удаленные документы не находятся поиском, документ, удаленный в другой копии, - находится
+    const auto contains = [](const std::vector<Document>& found, int document_id) {
+        return std::any_of(found.begin(), found.end(), [document_id](const Document& document) {
+            return document.id == document_id;
+        });
+    };
+    ASSERT(!contains(server.FindTopDocuments(documents[1], DocumentStatus::ACTUAL, 100'000), 1));
+    ASSERT(!contains(copy.FindTopDocuments(documents[1], DocumentStatus::ACTUAL, 100'000), 1));
+    ASSERT(contains(server.FindTopDocuments(documents[3], DocumentStatus::ACTUAL, 100'000), 3));
+    ASSERT(!contains(copy.FindTopDocuments(documents[3], DocumentStatus::ACTUAL, 100'000), 3));
+}
+
+// Тест снимков индекса: снимок не видит последующих изменений, запросы не мешают записи
+void TestIndexSnapshots() {
+    SearchServer server(""sv);
+    server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "black dog"s, DocumentStatus::ACTUAL, {2});
+    const auto snapshot = server.GetSnapshot();
+
+    server.AddDocument(3, "white dog"s, DocumentStatus::ACTUAL, {3});
+    server.RemoveDocument(1);
+    ASSERT_EQUAL(snapshot->GetDocumentCount(), 2);
+    ASSERT_EQUAL(snapshot->FindTopDocuments("white"s).size(), 1u);
+    ASSERT_EQUAL(snapshot->FindTopDocuments("white"s).at(0).id, 1);
+    ASSERT_EQUAL(std::get<0>(snapshot->MatchDocument("white cat"s, 1)).size(), 2u);
+    ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    ASSERT_EQUAL(server.FindTopDocuments("white"s).at(0).id, 3);
+
+    // Запросы к снимкам выполняются одновременно с добавлением документов.
+    // Каждый снимок согласован: слово common есть во всех документах
+    constexpr int document_count = 3'000;
+    std::thread writer([&server] {
+        for (int document_id = 10; document_id < 10 + document_count; ++document_id) {
+            server.AddDocument(document_id, "common word"s + std::to_string(document_id % 10), DocumentStatus::ACTUAL, {1});
+            if (document_id % 7 == 0) {
+                server.RemoveDocument(document_id - 5);
+            }
+        }
+    });
+    for (int i = 0; i < 200; ++i) {
+        const auto current = server.GetSnapshot();
+        const size_t found = current->FindTopDocuments(std::execution::par, "common"s, DocumentStatus::ACTUAL, 100'000).size();
+        ASSERT_EQUAL(found + 2, static_cast<size_t>(current->GetDocumentCount()));
+    }
+    writer.join();
+    ASSERT_EQUAL(server.FindTopDocuments("common"s, DocumentStatus::ACTUAL, 100'000).size() + 2,
+                 static_cast<size_t>(server.GetDocumentCount()));
+
+    // Копия сегмента разделяет куски карты удаленных: отметка в одной копии не видна в другой
+    ChunkedBitmap deleted(3 * ChunkedBitmap::CHUNK_BITS);
+    deleted.Set(1);
+    ChunkedBitmap copy = deleted;
+    copy.Set(ChunkedBitmap::CHUNK_BITS + 5);
+    deleted.Set(2);
+    ASSERT(copy.Test(1) && deleted.Test(1));
+    ASSERT(copy.Test(ChunkedBitmap::CHUNK_BITS + 5) && !deleted.Test(ChunkedBitmap::CHUNK_BITS + 5));
+    ASSERT(deleted.Test(2) && !copy.Test(2));
+    copy.Resize(4 * ChunkedBitmap::CHUNK_BITS);
+    ASSERT(!copy.Test(3 * ChunkedBitmap::CHUNK_BITS));
+    ASSERT_EQUAL(deleted.size(), 3 * ChunkedBitmap::CHUNK_BITS);
+}
+
+// Тест удаления через отметки об удалении и последующего вычищения сегментов
+void TestLazyRemoveDocument() {
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 10);
+    SearchServer server(""sv);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 7)});
+    }
+    const auto snapshot = server.GetSnapshot();
+
+    // Удаление 10% документов не вызывает слияний: документы только отмечаются удаленными
+    for (int document_id = 0; document_id < 10'000; document_id += 10) {
+        server.RemoveDocument(document_id);
+    }
+    ASSERT_EQUAL(server.GetDeletedDocumentCount(), 1'000u);
+    ASSERT_EQUAL(server.GetDocumentCount(), 9'000);
+    ASSERT_EQUAL(snapshot->GetDocumentCount(), 10'000);
+    ASSERT(!snapshot->GetWordFrequencies(0).empty());
+
+    // После удаления 40% документов сегменты вычищаются слиянием
+    for (int document_id = 0; document_id < 10'000; ++document_id) {
+        if (document_id % 10 > 0 && document_id % 10 < 4) {
+            server.RemoveDocument(document_id);
+        }
+    }
+    server.WaitForMerge();
+    // Сегмент, вычищенный до конца удалений, снова набирает удаленные документы, но меньше доли MAX_DELETED_RATIO.
+    // Сколько сегментов успеет вычиститься до конца удалений, зависит от скорости фонового слияния
+    const size_t deleted_count = server.GetDeletedDocumentCount();
+    ASSERT(deleted_count < 4'000u);
+    ASSERT(deleted_count <= (server.GetDocumentCount() + deleted_count) * SearchServer::MAX_DELETED_RATIO);
+
+    SearchServer expected_server(""sv);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        if (i % 10 >= 4) {
+            expected_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 7)});
+        }
+    }
+    for (int i = 0; i < 20; ++i) {
+        const std::string query = GenerateQuery(generator, dictionary, 5, 0.2);
+        for (const auto& policy_docs : {server.FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL, 20),
+                                        server.FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL, 20),
+                                        server.FindTopDocuments(query, DocumentStatus::ACTUAL, {20, ScoreAccumulatorType::MAP})}) {
+            const auto expected = expected_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 20);
+            ASSERT_EQUAL(policy_docs.size(), expected.size());
+            for (size_t j = 0; j < expected.size(); ++j) {
+                ASSERT_EQUAL(policy_docs[j].id, expected[j].id);
+                ASSERT(EqualNumbers(policy_docs[j].relevance, expected[j].relevance, 1e-9));
+            }
+        }
+    }
+}
+
+// Тест пакетного удаления документов и удаления дубликатов
+void TestRemoveDocuments() {
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 6'000, 10);
+    SearchServer batch_server(""sv);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        batch_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+    }
+    SearchServer single_server = batch_server;
+
+    // Повторяющиеся и отсутствующие id пропускаются
+    std::vector<int> removed_ids = {-1, 10'000, 5, 5};
+    for (int document_id = 0; document_id < 6'000; document_id += 3) {
+        removed_ids.push_back(document_id);
+        single_server.RemoveDocument(document_id);
+    }
+    single_server.RemoveDocument(5);
+    batch_server.RemoveDocuments(removed_ids);
+    ASSERT_EQUAL(batch_server.GetDocumentCount(), single_server.GetDocumentCount());
+    for (int i = 0; i < 20; ++i) {
+        const std::string query = GenerateQuery(generator, dictionary, 5, 0.2);
+        const auto batch_docs = batch_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 20);
+        const auto single_docs = single_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 20);
+        ASSERT_EQUAL(batch_docs.size(), single_docs.size());
+        for (size_t j = 0; j < batch_docs.size(); ++j) {
+            ASSERT_EQUAL(batch_docs[j].id, single_docs[j].id);
+            ASSERT(EqualNumbers(batch_docs[j].relevance, single_docs[j].relevance, 1e-12));
+        }
+    }
+
+    SearchServer server("and"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(4, "nasty rat and funny pet pet"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(5, "curly hair"s, DocumentStatus::ACTUAL, {1});
+    RemoveDuplicates(server);
+    ASSERT_EQUAL(server.GetDocumentCount(), 3);
+    ASSERT(std::vector<int>(server.begin(), server.end()) == (std::vector<int>{1, 2, 5}));
+}
+
 std::string GenerateWord(std::mt19937& generator, int max_length) {
     const int length = std::uniform_int_distribution(1, max_length)(generator);
     std::string word;
@@ -323,6 +802,649 @@ std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vec
     return queries;
 }
 
+void TestIndexFile() {
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 2 * SearchServer::WRITE_SEGMENT_CAPACITY + 100, 10);
+    SearchServer server("and with"s);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        server.AddDocument(static_cast<int>(i), documents[i], static_cast<DocumentStatus>(i % 3), {static_cast<int>(i % 7)});
+    }
+    // Удаленные документы есть и в запечатанных сегментах, и в сегменте записи
+    server.RemoveDocuments({1, 2, 3, static_cast<int>(documents.size()) - 1});
+
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_test.idx").string();
+    server.SaveSnapshot(path);
+    {
+        const SearchServer loaded = SearchServer::OpenSnapshot(path);
+        ASSERT_EQUAL(loaded.GetDocumentCount(), server.GetDocumentCount());
+        ASSERT(std::vector<int>(loaded.begin(), loaded.end()) == std::vector<int>(server.begin(), server.end()));
+        for (int i = 0; i < 20; ++i) {
+            const std::string query = GenerateQuery(generator, dictionary, 5, 0.2);
+            for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+                const auto expected = server.FindTopDocuments(query, status, 20);
+                const auto found = loaded.FindTopDocuments(query, status, 20);
+                ASSERT_EQUAL(found.size(), expected.size());
+                for (size_t j = 0; j < found.size(); ++j) {
+                    ASSERT_EQUAL(found[j].id, expected[j].id);
+                    ASSERT_EQUAL(found[j].rating, expected[j].rating);
+                    ASSERT(EqualNumbers(found[j].relevance, expected[j].relevance, 1e-12));
+                }
+            }
+        }
+        ASSERT(loaded.GetWordFrequencies(10) == server.GetWordFrequencies(10));
+        const auto [words, status] = loaded.MatchDocument("and "s + documents[10], 10);
+        ASSERT(words == std::get<0>(server.MatchDocument("and "s + documents[10], 10)));
+        ASSERT(status == static_cast<DocumentStatus>(10 % 3));
+        ASSERT(loaded.GetWordFrequencies(2).empty());
+
+        // Открытый сервер можно менять: файл при этом не меняется
+        SearchServer changed = loaded;
+        changed.AddDocument(100'000, "completely new words"s, DocumentStatus::ACTUAL, {5});
+        changed.RemoveDocument(10);
+        ASSERT_EQUAL(changed.FindTopDocuments("completely"s).size(), 1u);
+        ASSERT(changed.GetWordFrequencies(10).empty());
+        ASSERT(!loaded.GetWordFrequencies(10).empty());
+        ASSERT(loaded.FindTopDocuments("completely"s).empty());
+    }
+
+    // Файлы другой версии и другого формата не открываются
+    const auto is_rejected = [&path] {
+        try {
+            [[maybe_unused]] const SearchServer broken = SearchServer::OpenSnapshot(path);
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    {
+        // Файл заканчивается таблицей документов последнего сегмента: портим номер документа последней записи
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        const DocumentOrdinal ordinal = std::numeric_limits<DocumentOrdinal>::max() - 1;
+        file.seekp(-static_cast<std::streamoff>(sizeof(ordinal)), std::ios::end);
+        file.write(reinterpret_cast<const char*>(&ordinal), sizeof(ordinal));
+    }
+    ASSERT(is_rejected());
+    server.SaveSnapshot(path);
+    {
+        // Сегмент с id термов, которых нет в словаре, не открывается
+        IndexSegment segment;
+        segment.AddDocument({1, 0, DocumentStatus::ACTUAL, {}, {{0, 0.5}, {7, 0.5}}});
+        segment.Seal();
+        const auto storage = std::make_shared<const IndexSegment>(segment);
+        ASSERT_EQUAL(IndexSegment::Open(storage, storage->GetBytes(), 8).GetPostings(7).size(), 1u);
+        bool thrown = false;
+        try {
+            [[maybe_unused]] const IndexSegment opened = IndexSegment::Open(storage, storage->GetBytes(), 7);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        const uint32_t version = SearchServer::INDEX_FILE_VERSION + 1;
+        file.seekp(8);  // Версия записана сразу после сигнатуры
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+    ASSERT(is_rejected());
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << "not an index file"s;
+    }
+    ASSERT(is_rejected());
+    std::remove(path.c_str());
+}
+
+void TestCorpusIngestion() {
+    const NewDocument parsed = ParseCorpusLine("17\tBANNED\t5 -2 8\tfunny pet\twith tab\r"sv);
+    ASSERT_EQUAL(parsed.id, 17);
+    ASSERT(parsed.status == DocumentStatus::BANNED);
+    ASSERT(parsed.ratings == (std::vector<int>{5, -2, 8}));
+    ASSERT_EQUAL(parsed.text, "funny pet\twith tab"sv);
+    ASSERT(ParseCorpusLine("18\tACTUAL\t\tno ratings"sv).ratings.empty());
+
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 3'000, 10);
+    SearchServer expected_server("and with"s);
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_corpus.tsv").string();
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            const auto status = static_cast<DocumentStatus>(i % 3);
+            const std::string status_name = status == DocumentStatus::ACTUAL ? "ACTUAL"s
+                                          : status == DocumentStatus::IRRELEVANT ? "IRRELEVANT"s
+                                          : "BANNED"s;
+            out << i << '\t' << status_name << '\t' << i % 5 << ' ' << i % 7 << '\t' << documents[i] << '\n';
+            expected_server.AddDocument(static_cast<int>(i), documents[i], status, {static_cast<int>(i % 5), static_cast<int>(i % 7)});
+        }
+        // Документ без рейтингов принимается
+        out << "9000\tACTUAL\t\tno ratings\n"s;
+        expected_server.AddDocument(9000, "no ratings"s, DocumentStatus::ACTUAL, {});
+        // Строки с ошибками и повторяющийся id пропускаются, пустые строки не считаются
+        out << "x\tACTUAL\t1\tbad id\n"s << "5000\tUNKNOWN\t1\tbad status\n"s << "\n"s << "7\tACTUAL\t1\tduplicate"s;
+    }
+
+    IngestionOptions options;
+    options.thread_count = 3;
+    options.chunk_size = 1'000;
+    options.batch_size = 100;
+    options.max_pending_batches = 1;
+    options.report_interval = std::chrono::milliseconds::zero();
+    SearchServer server("and with"s);
+    const IngestionStats stats = IngestCorpus(server, path, options);
+    std::remove(path.c_str());
+
+    ASSERT_EQUAL(stats.document_count, documents.size() + 1);
+    ASSERT_EQUAL(stats.rejected_line_count, 3u);
+    ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+    for (int i = 0; i < 20; ++i) {
+        const std::string query = GenerateQuery(generator, dictionary, 5, 0.2);
+        const auto expected = expected_server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 20);
+        const auto found = server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 20);
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t j = 0; j < found.size(); ++j) {
+            ASSERT_EQUAL(found[j].id, expected[j].id);
+            ASSERT_EQUAL(found[j].rating, expected[j].rating);
+            ASSERT(EqualNumbers(found[j].relevance, expected[j].relevance, 1e-12));
+        }
+    }
+}
+
+void TestDocumentTextStorage() {
+    // Память выделяется кусками, а не на каждый текст
+    TextArena arena;
+    std::vector<std::string_view> texts;
+    std::string text(1'000, 'a');
+    for (int i = 0; i < 3'000; ++i) {
+        text.front() = static_cast<char>('a' + i % 26);
+        texts.push_back(arena.Append(text));
+    }
+    ASSERT_EQUAL(arena.GetChunkCount(), 3u);
+    for (int i = 0; i < 3'000; ++i) {
+        ASSERT_EQUAL(texts[i].size(), 1'000u);
+        ASSERT_EQUAL(texts[i].front(), static_cast<char>('a' + i % 26));
+    }
+    // Копии дописывают тексты в общий кусок, не затирая друг друга
+    TextArena copy = arena;
+    const std::string_view copy_text = copy.Append("copy"sv);
+    const std::string_view arena_text = arena.Append("original"sv);
+    ASSERT_EQUAL(copy_text, "copy"sv);
+    ASSERT_EQUAL(arena_text, "original"sv);
+    ASSERT_EQUAL(copy.GetChunkCount(), 3u);
+    ASSERT_EQUAL(arena.Append(std::string(TextArena::CHUNK_SIZE + 1, 'b')).size(), TextArena::CHUNK_SIZE + 1);
+    ASSERT_EQUAL(arena.GetChunkCount(), 4u);
+
+    // Сервер без текстов документов находит то же самое, а его индекс меньше на размер текстов
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 3'000, 10);
+    SearchServer server_with_text("and with"s);
+    SearchServer server_without_text("and with"s, IndexOptions{false});
+    size_t text_size = 0;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        server_with_text.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+        server_without_text.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+        text_size += documents[i].size();
+    }
+    for (int i = 0; i < 10; ++i) {
+        const std::string query = GenerateQuery(generator, dictionary, 5, 0.2);
+        const auto expected = server_with_text.FindTopDocuments(query);
+        const auto found = server_without_text.FindTopDocuments(query);
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t j = 0; j < found.size(); ++j) {
+            ASSERT_EQUAL(found[j].id, expected[j].id);
+        }
+    }
+    const auto directory = std::filesystem::temp_directory_path();
+    server_with_text.SaveSnapshot((directory / "search_server_text.idx").string());
+    server_without_text.SaveSnapshot((directory / "search_server_no_text.idx").string());
+    ASSERT(std::filesystem::file_size(directory / "search_server_text.idx")
+           >= std::filesystem::file_size(directory / "search_server_no_text.idx") + text_size);
+    std::filesystem::remove(directory / "search_server_text.idx");
+    std::filesystem::remove(directory / "search_server_no_text.idx");
+}
+
+void TestMemoryStats() {
+    // Распределитель считает память контейнера, копия контейнера считает свою память отдельно
+    std::vector<int, TrackingAllocator<int>> values;
+    values.reserve(100);
+    ASSERT_EQUAL(values.get_allocator().GetAllocatedBytes(), 100 * sizeof(int));
+    const auto copy = values;
+    ASSERT_EQUAL(values.get_allocator().GetAllocatedBytes(), 100 * sizeof(int));
+    auto moved = std::move(values);
+    values.push_back(1);
+    moved.clear();
+    moved.shrink_to_fit();
+    ASSERT_EQUAL(values.get_allocator().GetAllocatedBytes(), sizeof(int));
+
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 5'000, 10);
+    SearchServer server("and with"s);
+    SearchServer server_without_text("and with"s, IndexOptions{false});
+    std::set<std::string_view> words;
+    size_t text_size = 0;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+        server_without_text.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+        for (const std::string_view word : SplitIntoWords(documents[i])) {
+            words.insert(word);
+        }
+        text_size += documents[i].size();
+    }
+    const MemoryStats stats = server.GetMemoryStats();
+    ASSERT_EQUAL(stats.documents.elements, documents.size());
+    ASSERT_EQUAL(stats.document_ids.elements, documents.size());
+    ASSERT(stats.document_ids.bytes >= documents.size() * sizeof(int));
+    ASSERT_EQUAL(stats.document_texts.elements, text_size);
+    ASSERT(stats.document_texts.bytes >= text_size);
+    ASSERT_EQUAL(stats.term_dictionary.elements, words.size());
+    ASSERT(stats.inverted_index.bytes >= stats.inverted_index.elements * sizeof(DocumentOrdinal));
+    ASSERT_EQUAL(stats.stop_words.elements, 2u);
+    ASSERT_EQUAL(stats.mapped_bytes, 0u);
+    ASSERT_EQUAL(server_without_text.GetMemoryStats().document_texts.elements, 0u);
+
+    // Индекс, открытый из файла, читается из отображенной памяти
+    const auto path = (std::filesystem::temp_directory_path() / "search_server_memory.idx").string();
+    server.SaveSnapshot(path);
+    {
+        const SearchServer opened = SearchServer::OpenSnapshot(path);
+        const MemoryStats opened_stats = opened.GetMemoryStats();
+        ASSERT(opened_stats.mapped_bytes > 0);
+        ASSERT(opened_stats.mapped_bytes <= opened_stats.GetTotalBytes());
+        ASSERT_EQUAL(opened_stats.inverted_index.elements, stats.inverted_index.elements);
+        ASSERT_EQUAL(opened_stats.document_texts.elements, text_size);
+    }
+    std::filesystem::remove(path);
+}
+
+void TestSplitIntoWords() {
+    // Разбиение через find, как до перехода на блоки
+    const auto split_by_find = [](std::string_view str) {
+        std::vector<std::string_view> words;
+        while (true) {
+            const size_t space = str.find(' ');
+            words.push_back(str.substr(0, space));
+            if (space == std::string_view::npos) {
+                return words;
+            }
+            str.remove_prefix(space + 1);
+        }
+    };
+    const auto is_valid_by_char = [](std::string_view str) {
+        return std::none_of(str.begin(), str.end(), [](char c) {
+            return c >= '\0' && c < ' ';
+        });
+    };
+
+    // Строки разной длины, чтобы пробелы и спец-символы попадали и в блоки, и в остаток
+    std::mt19937 generator;
+    const std::string alphabet = "ab  \x01\x1f\x7f\x80\xff-"s;
+    std::vector<std::string_view> words;
+    for (int i = 0; i < 2'000; ++i) {
+        std::string text(std::uniform_int_distribution(0, 100)(generator), 'a');
+        for (char& c : text) {
+            c = alphabet[std::uniform_int_distribution<size_t>(0, alphabet.size() - 1)(generator)];
+        }
+        const bool is_valid = SplitIntoWords(text, words);
+        ASSERT(words == split_by_find(text));
+        ASSERT_EQUAL(is_valid, is_valid_by_char(text));
+        ASSERT_EQUAL(IsValidWord(text), is_valid_by_char(text));
+    }
+    ASSERT(SplitIntoWords(""sv) == std::vector<std::string_view>{""sv});
+
+    // Документ со спец-символом не добавляется, запрос со спец-символом отклоняется
+    SearchServer server("and"s);
+    try {
+        server.AddDocument(1, "curly cat\x12 and dog"s, DocumentStatus::ACTUAL, {1});
+        ASSERT_HINT(false, "Документ со спец-символом добавлен");
+    } catch (const std::invalid_argument&) {
+    }
+    server.AddDocument(1, "curly cat and dog"s, DocumentStatus::ACTUAL, {1});
+    try {
+        (void) server.FindTopDocuments("cat\x05"s);
+        ASSERT_HINT(false, "Запрос со спец-символом выполнен");
+    } catch (const std::invalid_argument&) {
+    }
+
+    std::cerr << std::endl;
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+    size_t word_count = 0;
+    {
+        LOG_DURATION("SplitIntoWords by find");
+        for (const std::string& document : documents) {
+            const auto document_words = split_by_find(document);
+            word_count += std::count_if(document_words.begin(), document_words.end(), is_valid_by_char);
+        }
+    }
+    {
+        LOG_DURATION("SplitIntoWords by blocks");
+        for (const std::string& document : documents) {
+            if (SplitIntoWords(document, words)) {
+                word_count -= words.size();
+            }
+        }
+    }
+    ASSERT_EQUAL(word_count, 0u);
+}
+
+void TestStopWordSet() {
+    const StopWordSet empty_set;
+    ASSERT(!empty_set.Contains(""sv));
+    ASSERT(!empty_set.Contains("and"sv));
+
+    const StopWordSet stop_words(MakeUniqueNonEmptyStrings(SplitIntoWords("in the and an a with   the"sv)));
+    ASSERT_EQUAL(stop_words.size(), 6u);
+    ASSERT((std::vector<std::string_view>(stop_words.begin(), stop_words.end())
+            == std::vector<std::string_view>{"a"sv, "an"sv, "and"sv, "in"sv, "the"sv, "with"sv}));
+    for (const std::string_view word : {"a"sv, "an"sv, "and"sv, "in"sv, "the"sv, "with"sv}) {
+        ASSERT(stop_words.Contains(word));
+    }
+    for (const std::string_view word : {""sv, "andy"sv, "th"sv, "i"sv, "with "sv, "The"sv}) {
+        ASSERT(!stop_words.Contains(word));
+    }
+
+    // Проверка слов документов при добавлении и слов запросов
+    std::cerr << std::endl;
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+    const auto queries = GenerateQueries(generator, dictionary, 10'000, 7);
+    const std::set<std::string> words(dictionary.begin(), dictionary.begin() + 100);
+    const StopWordSet stop_word_set(words);
+    for (const auto* texts : {&documents, &queries}) {
+        std::vector<std::string_view> text_words;
+        size_t set_count = 0;
+        size_t stop_word_set_count = 0;
+        {
+            LOG_DURATION(texts == &documents ? "Document stop words std::set"s : "Query stop words std::set"s);
+            for (const std::string& text : *texts) {
+                SplitIntoWords(text, text_words);
+                for (const std::string_view word : text_words) {
+                    set_count += words.count(std::string(word));
+                }
+            }
+        }
+        {
+            LOG_DURATION(texts == &documents ? "Document stop words StopWordSet"s : "Query stop words StopWordSet"s);
+            for (const std::string& text : *texts) {
+                SplitIntoWords(text, text_words);
+                for (const std::string_view word : text_words) {
+                    stop_word_set_count += stop_word_set.Contains(word);
+                }
+            }
+        }
+        ASSERT_EQUAL(stop_word_set_count, set_count);
+    }
+}
+
+void TestQueryAllocations() {
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 5'000, 10);
+    SearchServer server(dictionary[0] + " "s + dictionary[1]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+    }
+    server.WaitForMerge();
+    const std::string query = dictionary[0] + " "s + dictionary[2] + " -"s + dictionary[3] + " "s + dictionary[4] + " "s + dictionary[2];
+    const int document_id = server.FindTopDocuments(query).at(0).id;
+
+    // После первого запроса буферы потока и накопитель готовы: запрос выделяет память только под результат
+    // Счетчик читается до ASSERT_EQUAL, который сам выделяет память под строки
+    size_t allocations_before = allocation_count;
+    const auto found = server.FindTopDocuments(query);
+    size_t allocations = allocation_count - allocations_before;
+    ASSERT_EQUAL(allocations, 1u);
+    ASSERT_EQUAL(found.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+
+    (void) server.MatchDocument(query, document_id);
+    allocations_before = allocation_count;
+    const auto [words, status] = server.MatchDocument(query, document_id);
+    allocations = allocation_count - allocations_before;
+    ASSERT_EQUAL(allocations, 1u);
+    ASSERT(!words.empty());
+
+    // Длинный запрос не помещается во внутренние буферы, но находит то же, что и короткий
+    std::string long_query = query;
+    for (int i = 0; i < 40; ++i) {
+        long_query += " "s + dictionary[2];
+    }
+    for (int i = 5; i < 25; ++i) {
+        long_query += " -"s + dictionary[100 + i] + "_absent"s;
+    }
+    const auto long_found = server.FindTopDocuments(long_query);
+    ASSERT_EQUAL(long_found.size(), found.size());
+    for (size_t i = 0; i < found.size(); ++i) {
+        ASSERT_EQUAL(long_found[i].id, found[i].id);
+    }
+}
+
+void TestPreparedQuery() {
+    const auto assert_equal_documents = [](const std::vector<Document>& found, const std::vector<Document>& expected) {
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT(EqualNumbers(found[i].relevance, expected[i].relevance, 1e-12));
+        }
+    };
+    const auto even_id = [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 0;
+    };
+
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 6'000, 10);
+    SearchServer server(dictionary[0]);
+    for (size_t i = 0; i < 5'000; ++i) {
+        server.AddDocument(static_cast<int>(i), documents[i], static_cast<DocumentStatus>(i % 2), {1});
+    }
+    std::vector<std::string> queries;
+    for (int i = 0; i < 10; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, 6, 0.3));
+    }
+
+    for (const std::string& query : queries) {
+        const PreparedQuery prepared = server.Prepare(query);
+        ASSERT_EQUAL(prepared.GetText(), query);
+        assert_equal_documents(server.FindTopDocuments(prepared), server.FindTopDocuments(query));
+        assert_equal_documents(server.FindTopDocuments(std::execution::seq, prepared, DocumentStatus::IRRELEVANT),
+                               server.FindTopDocuments(std::execution::seq, query, DocumentStatus::IRRELEVANT));
+        assert_equal_documents(server.FindTopDocuments(std::execution::par, prepared, even_id),
+                               server.FindTopDocuments(std::execution::par, query, even_id));
+        for (int document_id = 0; document_id < 50; ++document_id) {
+            ASSERT(server.MatchDocument(prepared, document_id) == server.MatchDocument(query, document_id));
+            ASSERT(server.MatchDocument(std::execution::par, prepared, document_id)
+                   == server.MatchDocument(std::execution::par, query, document_id));
+        }
+    }
+
+    // Запрос, подготовленный до изменения сервера, учитывает новые документы, слова и IDF
+    const PreparedQuery prepared = server.Prepare(queries[0] + " new_word"s);
+    const SearchServer copy = server;
+    for (size_t i = 5'000; i < documents.size(); ++i) {
+        server.AddDocument(static_cast<int>(i), documents[i] + " new_word"s, DocumentStatus::ACTUAL, {1});
+    }
+    server.RemoveDocument(0);
+    assert_equal_documents(server.FindTopDocuments(prepared), server.FindTopDocuments(queries[0] + " new_word"s));
+    assert_equal_documents(copy.FindTopDocuments(prepared), copy.FindTopDocuments(queries[0] + " new_word"s));
+    ASSERT(server.MatchDocument(prepared, 5'500) == server.MatchDocument(queries[0] + " new_word"s, 5'500));
+
+    try {
+        (void) server.Prepare("cat --dog"s);
+        ASSERT_HINT(false, "Запрос с двумя минусами подготовлен");
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+void TestMatchDocuments() {
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 2'000, 10);
+    SearchServer server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        server.AddDocument(static_cast<int>(i) * 2, documents[i], static_cast<DocumentStatus>(i % 4), {1});
+    }
+    server.RemoveDocument(10);
+    const std::vector<int> document_ids(server.begin(), server.end());
+
+    // Длинный запрос сопоставляется слиянием с термами документа, короткий - поиском в списках вхождений
+    for (const std::string& query : {GenerateQuery(generator, dictionary, 200, 0.1), GenerateQuery(generator, dictionary, 3, 0.3)}) {
+        const PreparedQuery prepared = server.Prepare(query);
+        const auto results = server.MatchDocuments(query, document_ids);
+        const auto par_results = server.MatchDocuments(std::execution::par, prepared, document_ids);
+        ASSERT_EQUAL(results.size(), document_ids.size());
+        ASSERT_EQUAL(par_results.size(), document_ids.size());
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            const auto expected = server.MatchDocument(query, document_ids[i]);
+            ASSERT(results[i] == expected);
+            ASSERT(par_results[i] == expected);
+        }
+    }
+
+    ASSERT(server.MatchDocuments("cat"s, {}).empty());
+    try {
+        (void) server.MatchDocuments(std::execution::par, dictionary[1], {0, 1});
+        ASSERT_HINT(false, "Матчинг отсутствующего документа");
+    } catch (const std::out_of_range&) {
+    }
+}
+
+void TestResultCache() {
+    const auto assert_equal_documents = [](const std::vector<Document>& found, const std::vector<Document>& expected) {
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT(EqualNumbers(found[i].relevance, expected[i].relevance, 1e-12));
+        }
+    };
+
+    {
+        IndexOptions options;
+        options.result_cache_capacity = 64;
+        SearchServer server("and in on"s, options);
+        server.AddDocument(1, "white cat and fancy collar"s, DocumentStatus::ACTUAL, {8});
+        server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7});
+        server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, {5});
+
+        const auto found = server.FindTopDocuments("fluffy groomed cat"s);
+        ASSERT_EQUAL(found.size(), 2u);
+        // Порядок слов, повторы, стоп-слова и неизвестные слова не меняют ключ
+        assert_equal_documents(server.FindTopDocuments("cat and groomed fluffy cat unknown"s), found);
+        assert_equal_documents(server.FindTopDocuments(std::execution::par, "groomed cat fluffy"s), found);
+        assert_equal_documents(server.FindTopDocuments(server.Prepare("cat fluffy groomed"s)), found);
+        ResultCacheStats stats = server.GetResultCacheStats();
+        ASSERT_EQUAL(stats.hits, 3u);
+        ASSERT_EQUAL(stats.misses, 1u);
+        ASSERT_EQUAL(stats.size, 1u);
+
+        // Другой статус и другие минус-слова - другие ключи
+        ASSERT_EQUAL(server.FindTopDocuments("fluffy groomed cat"s, DocumentStatus::BANNED).size(), 1u);
+        ASSERT_EQUAL(server.FindTopDocuments("fluffy groomed cat -collar"s).size(), 1u);
+        // Предикат обходит кеш
+        ASSERT_EQUAL(server.FindTopDocuments("fluffy groomed cat"s, [](int document_id, DocumentStatus, int) {
+            return document_id == 1;
+        }).size(), 1u);
+        stats = server.GetResultCacheStats();
+        ASSERT_EQUAL(stats.hits, 3u);
+        ASSERT_EQUAL(stats.misses, 3u);
+        ASSERT_EQUAL(stats.size, 3u);
+
+        // Изменение индекса делает результаты недействительными
+        server.AddDocument(4, "fluffy fluffy cat"s, DocumentStatus::ACTUAL, {9});
+        ASSERT_EQUAL(server.FindTopDocuments("fluffy groomed cat"s).size(), 3u);
+        server.RemoveDocument(4);
+        assert_equal_documents(server.FindTopDocuments("fluffy groomed cat"s), found);
+        stats = server.GetResultCacheStats();
+        ASSERT_EQUAL(stats.hits, 3u);
+        ASSERT_EQUAL(stats.invalidations, 2u);
+
+        // Снимок, взятый до изменения, видит свои результаты, но не вытесняет результаты новой версии
+        const auto snapshot = server.GetSnapshot();
+        server.AddDocument(5, "cat"s, DocumentStatus::ACTUAL, {1});
+        ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), 3u);
+        ASSERT_EQUAL(snapshot->FindTopDocuments("cat"s).size(), 2u);
+        ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), 3u);
+
+        // Копия сервера заводит свой кеш
+        const SearchServer copy = server;
+        ASSERT_EQUAL(copy.GetResultCacheStats().size, 0u);
+        assert_equal_documents(copy.FindTopDocuments("cat"s), server.FindTopDocuments("cat"s));
+    }
+
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 300, 6);
+    const auto documents = GenerateQueries(generator, dictionary, 5'000, 10);
+    IndexOptions options;
+    options.result_cache_capacity = 32;
+    SearchServer cached_server(dictionary[0], options);
+    SearchServer server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        cached_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+        server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+    }
+    const auto queries = GenerateQueries(generator, dictionary, 200, 5);
+    for (int round = 0; round < 2; ++round) {
+        for (const std::string& query : queries) {
+            assert_equal_documents(cached_server.FindTopDocuments(query), server.FindTopDocuments(query));
+        }
+    }
+    const ResultCacheStats stats = cached_server.GetResultCacheStats();
+    ASSERT(stats.evictions > 0);
+    ASSERT(stats.size <= 32);
+    ASSERT_EQUAL(stats.hits + stats.misses, queries.size() * 2);
+
+    // Запросы через очередь по статусу используют кеш
+    RequestQueue request_queue(cached_server);
+    (void) request_queue.AddFindRequest(queries[0]);
+    (void) request_queue.AddFindRequest(queries[0]);
+    ASSERT_EQUAL(cached_server.GetResultCacheStats().hits, stats.hits + 1);
+
+    // Слияние сегментов не меняет результатов и не сбрасывает кеш
+    {
+        IndexOptions merge_options;
+        merge_options.result_cache_capacity = 64;
+        SearchServer merge_server(dictionary[0], merge_options);
+        for (size_t i = 0; i < 4 * SearchServer::WRITE_SEGMENT_CAPACITY; ++i) {
+            merge_server.AddDocument(static_cast<int>(i), documents[i % documents.size()], DocumentStatus::ACTUAL, {1});
+        }
+        const auto before_merge = merge_server.FindTopDocuments(queries[0]);
+        ASSERT_EQUAL(merge_server.GetSegmentCount(), 4u);
+        merge_server.WaitForMerge();
+        ASSERT_EQUAL(merge_server.GetSegmentCount(), 1u);
+        assert_equal_documents(merge_server.FindTopDocuments(queries[0]), before_merge);
+        const ResultCacheStats merge_stats = merge_server.GetResultCacheStats();
+        ASSERT_EQUAL(merge_stats.hits, 1u);
+        ASSERT_EQUAL(merge_stats.invalidations, 0u);
+    }
+
+    // Неравномерный поток запросов: 10'000 запросов из 100 различных
+    std::cerr << std::endl;
+    options.result_cache_capacity = 1024;
+    SearchServer skewed_server(dictionary[0], options);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        skewed_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+    }
+    std::uniform_int_distribution<size_t> query_index(0, 99);
+    std::vector<std::string_view> skewed_queries;
+    for (int i = 0; i < 10'000; ++i) {
+        skewed_queries.push_back(queries[query_index(generator)]);
+    }
+    const auto run = [&skewed_queries](std::string_view mark, const SearchServer& search_server) {
+        LOG_DURATION(mark);
+        size_t found_count = 0;
+        for (const std::string_view query : skewed_queries) {
+            found_count += search_server.FindTopDocuments(query).size();
+        }
+        return found_count;
+    };
+    ASSERT_EQUAL(run("Skewed queries without cache"s, server), run("Skewed queries with cache"s, skewed_server));
+    std::cerr << skewed_server.GetResultCacheStats() << std::endl;
+}
+
 void TestQueriesProcessor() {
     std::cerr << std::endl;
     std::mt19937 generator;
@@ -370,6 +1492,8 @@ void TestParallelMatchDocument()  {
 
     TEST_PARALLEL_MATCH_DOCUMENT(seq);
     TEST_PARALLEL_MATCH_DOCUMENT(par);
+    TEST_PARALLEL_MATCH_DOCUMENTS(seq);
+    TEST_PARALLEL_MATCH_DOCUMENTS(par);
 }
 
 void TestParallelFindTopDocuments() {
@@ -390,6 +1514,150 @@ void TestParallelFindTopDocuments() {
     TEST_PARALLEL_FIND_DOCUMENTS(par);
 }
 
+// Сравнение накопителей релевантности: результаты совпадают, время выводится для каждого
+void TestScoreAccumulators() {
+    std::cerr << std::endl;
+    std::mt19937 generator;
+
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+
+    const auto queries = GenerateQueries(generator, dictionary, 100, 70);
+
+    const auto map_results = TEST_SCORE_ACCUMULATOR(MAP);
+    const auto dense_results = TEST_SCORE_ACCUMULATOR(DENSE);
+    ASSERT_EQUAL(map_results.size(), dense_results.size());
+    for (size_t i = 0; i < map_results.size(); ++i) {
+        ASSERT_EQUAL(map_results[i].size(), dense_results[i].size());
+        for (size_t j = 0; j < map_results[i].size(); ++j) {
+            ASSERT_EQUAL(map_results[i][j].id, dense_results[i][j].id);
+        }
+    }
+}
+
+// Сравнение пакетного добавления с добавлением по одному документу
+void TestInterleavedAddAndFind() {
+    std::cerr << std::endl;
+    std::mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 50'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 14'000, 30);
+    constexpr size_t initial_count = 10'000;
+
+    SearchServer interleaved_server(""sv);
+    for (size_t i = 0; i < initial_count; ++i) {
+        interleaved_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+    }
+    // Копия разделяет с сервером незапечатанный сегмент. Первым в него дописывает interleaved_server,
+    // а batched_server переносит свои документы в собственный сегмент
+    SearchServer batched_server = interleaved_server;
+    const auto initial_snapshot = interleaved_server.GetSnapshot();
+
+    size_t found_count = 0;
+    {
+        LOG_DURATION("Interleaved AddDocument and FindTopDocuments"s);
+        for (size_t i = initial_count; i < documents.size(); ++i) {
+            interleaved_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+            found_count += interleaved_server.FindTopDocuments(documents[i]).size();
+        }
+    }
+    {
+        LOG_DURATION("AddDocument, then FindTopDocuments"s);
+        for (size_t i = initial_count; i < documents.size(); ++i) {
+            batched_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1});
+        }
+        for (size_t i = initial_count; i < documents.size(); ++i) {
+            found_count += batched_server.FindTopDocuments(documents[i]).size();
+        }
+    }
+    ASSERT_EQUAL(interleaved_server.GetDocumentCount(), batched_server.GetDocumentCount());
+    ASSERT(found_count > 0);
+    for (size_t i = initial_count; i < documents.size(); i += 250) {
+        const auto interleaved_found = interleaved_server.FindTopDocuments(documents[i]);
+        const auto batched_found = batched_server.FindTopDocuments(documents[i]);
+        ASSERT_EQUAL(interleaved_found.size(), batched_found.size());
+        for (size_t j = 0; j < interleaved_found.size(); ++j) {
+            ASSERT_EQUAL(interleaved_found[j].id, batched_found[j].id);
+        }
+        // Снимок, опубликованный до добавления, новых документов не видит
+        for (const Document& document : initial_snapshot->FindTopDocuments(documents[i])) {
+            ASSERT(document.id < static_cast<int>(initial_count));
+        }
+    }
+    ASSERT_EQUAL(initial_snapshot->GetDocumentCount(), static_cast<int>(initial_count));
+}
+
+void TestAddDocuments() {
+    std::cerr << std::endl;
+    std::mt19937 generator;
+
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+
+    SearchServer search_server(documents[0].substr(0, documents[0].find(' ')));
+    {
+        LOG_DURATION("AddDocument");
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+    std::cerr << search_server.GetMemoryStats();
+    const SearchServer seq_server = TEST_ADD_DOCUMENTS(seq);
+    const SearchServer par_server = TEST_ADD_DOCUMENTS(par);
+
+    ASSERT_EQUAL(seq_server.GetDocumentCount(), search_server.GetDocumentCount());
+    ASSERT_EQUAL(par_server.GetDocumentCount(), search_server.GetDocumentCount());
+    for (const std::string& query : GenerateQueries(generator, dictionary, 100, 10)) {
+        const auto expected = search_server.FindTopDocuments(query);
+        for (const SearchServer* server : {&seq_server, &par_server}) {
+            const auto found = server->FindTopDocuments(query);
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL(found[i].id, expected[i].id);
+                ASSERT(EqualNumbers(found[i].relevance, expected[i].relevance, 1e-12));
+            }
+        }
+    }
+
+    // Пакет с ошибкой не добавляется целиком
+    SearchServer server(""sv);
+    bool thrown = false;
+    try {
+        server.AddDocuments({{1, "cat"sv, DocumentStatus::ACTUAL, {1}}, {2, "d\x12og"sv, DocumentStatus::ACTUAL, {1}}});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    thrown = false;
+    try {
+        server.AddDocuments({{1, "cat"sv, DocumentStatus::ACTUAL, {1}}, {1, "dog"sv, DocumentStatus::ACTUAL, {1}}});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    ASSERT_EQUAL(server.GetDocumentCount(), 0);
+
+    // Пакеты меньше записываемого сегмента дописываются в него, а не становятся отдельными сегментами
+    for (int id = 0; id < 20; id += 2) {
+        server.AddDocuments({{id, "cat"sv, DocumentStatus::ACTUAL, {1}}, {id + 1, "dog city"sv, DocumentStatus::ACTUAL, {1}}});
+    }
+    ASSERT_EQUAL(server.GetSegmentCount(), 0u);
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 100).size(), 10u);
+    std::vector<NewDocument> small_batch;
+    for (int id = 20; id < static_cast<int>(SearchServer::WRITE_SEGMENT_CAPACITY) + 19; ++id) {
+        small_batch.push_back({id, "rat"sv, DocumentStatus::ACTUAL, {1}});
+    }
+    // Заполненный записываемый сегмент запечатывается посреди пакета
+    server.AddDocuments(small_batch);
+    ASSERT_EQUAL(server.GetSegmentCount(), 1u);
+    ASSERT_EQUAL(server.GetDocumentCount(), static_cast<int>(SearchServer::WRITE_SEGMENT_CAPACITY) + 19);
+    ASSERT_EQUAL(server.FindTopDocuments("rat"s, DocumentStatus::ACTUAL, 10'000).size(), small_batch.size());
+}
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer() {
     RUN_TEST(TestAddDocument);
@@ -401,8 +1669,32 @@ void TestSearchServer() {
     RUN_TEST(TestFilterPredicate);
     RUN_TEST(TestDocumentsWithStatus);
     RUN_TEST(TestRelevanceValue);
+    RUN_TEST(TestPostingList);
+    RUN_TEST(TestTermDictionary);
+    RUN_TEST(TestTopDocumentsCount);
+    RUN_TEST(TestRemovedDocumentTombstone);
+    RUN_TEST(TestInverseDocumentFreqUpdates);
+    RUN_TEST(TestParallelSearchByRanges);
+    RUN_TEST(TestSegmentedIndex);
+    RUN_TEST(TestCopyDuringMerge);
+    RUN_TEST(TestIndexSnapshots);
+    RUN_TEST(TestLazyRemoveDocument);
+    RUN_TEST(TestRemoveDocuments);
+    RUN_TEST(TestIndexFile);
+    RUN_TEST(TestCorpusIngestion);
+    RUN_TEST(TestDocumentTextStorage);
+    RUN_TEST(TestMemoryStats);
+    RUN_TEST(TestSplitIntoWords);
+    RUN_TEST(TestStopWordSet);
+    RUN_TEST(TestQueryAllocations);
+    RUN_TEST(TestPreparedQuery);
+    RUN_TEST(TestMatchDocuments);
+    RUN_TEST(TestResultCache);
     RUN_TEST(TestQueriesProcessor);
     RUN_TEST(TestParallelRemoveDocument);
     RUN_TEST(TestParallelMatchDocument);
     RUN_TEST(TestParallelFindTopDocuments);
+    RUN_TEST(TestScoreAccumulators);
+    RUN_TEST(TestAddDocuments);
+    RUN_TEST(TestInterleavedAddAndFind);
 }
\ No newline at end of file
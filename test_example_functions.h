@@ -3,10 +3,14 @@
 #include <execution>
 #include <iostream>
 #include <random>
+#include "corpus_ingestion.h"
 #include "document.h"
 #include "log_duration.h"
+#include "text_arena.h"
 #include "search_server.h"
 #include "process_queries.h"
+#include "request_queue.h"
+#include "remove_duplicates.h"
 
 template <typename T, typename U>
 void AssertEqualImpl(const T& t, const U& u, const std::string& t_str, const std::string& u_str, const std::string& file,
@@ -83,6 +87,70 @@ void TestDocumentsWithStatus();
 // Тест на корректное вычисление релевантности найденных документов
 void TestRelevanceValue();
 
+// Тест списка вхождений: поиск по указателям пропуска в списках незапечатанного и запечатанного сегментов
+void TestPostingList();
+
+// Тест словаря термов: слова остаются доступными после удаления документа, который их добавил
+void TestTermDictionary();
+
+// Тест выбора top_k документов: размер выдачи задается при вызове, порядок совпадает с полной сортировкой
+void TestTopDocumentsCount();
+
+// Тест удаления документа: номер удаленного документа не переиспользуется, документ остается в сегменте
+// с отметкой об удалении до сжатия или слияния сегмента, но не виден ни поиску, ни MatchDocument
+void TestRemovedDocumentTombstone();
+
+// Тест пересчета IDF после добавления и удаления документов
+void TestInverseDocumentFreqUpdates();
+
+// Тест параллельного поиска по диапазонам документов: результаты совпадают с последовательным поиском
+void TestParallelSearchByRanges();
+
+// Тест сегментированного индекса: запечатывание, фоновое слияние и удаление из сегментов
+void TestSegmentedIndex();
+
+// Тест копирования сервера во время фонового слияния: удаления копий не видны друг другу
+void TestCopyDuringMerge();
+
+// Тест снимков индекса: снимок не видит последующих изменений, запросы не мешают записи
+void TestIndexSnapshots();
+
+// Тест удаления через отметки об удалении и последующего вычищения сегментов
+void TestLazyRemoveDocument();
+
+// Тест пакетного удаления документов и удаления дубликатов
+void TestRemoveDocuments();
+
+// Тест сохранения индекса в файл и работы сервера, открытого из файла. Поврежденные файлы не открываются
+void TestIndexFile();
+
+// Тест потоковой загрузки корпуса из файла
+void TestCorpusIngestion();
+
+// Тест хранения текстов документов кусками и сервера без текстов документов
+void TestDocumentTextStorage();
+
+// Тест учета памяти индекса по структурам
+void TestMemoryStats();
+
+// Тест разбиения на слова блоками: результат совпадает с разбиением по одному символу
+void TestSplitIntoWords();
+
+// Тест множества стоп-слов и сравнение его скорости с std::set
+void TestStopWordSet();
+
+// Тест запросов без выделения памяти: прогретый запрос выделяет память только под результат
+void TestQueryAllocations();
+
+// Тест подготовленных запросов: результаты совпадают с разбором текста запроса, в том числе после изменения сервера
+void TestPreparedQuery();
+
+// Тест пакетного матчинга: результаты совпадают с MatchDocument для каждого документа
+void TestMatchDocuments();
+
+// Тест кеша результатов: нормализация запросов, сброс после изменения индекса, вытеснение и обход кеша предикатами
+void TestResultCache();
+
 template <typename Function>
 void RunTestImpl(Function func, const std::string& func_str) {
     func();
@@ -119,8 +187,19 @@ void TestParallelMatchDocumentImpl(std::string_view mark, SearchServer search_se
     LOG_DURATION(mark);
     const int document_count = search_server.GetDocumentCount();
     int word_count = 0;
+    const PreparedQuery prepared_query = search_server.Prepare(query);
     for (int id = 0; id < document_count; ++id) {
-        const auto [words, status] = search_server.MatchDocument(policy, query, id);
+        const auto [words, status] = search_server.MatchDocument(policy, prepared_query, id);
+        word_count += words.size();
+    }
+}
+
+template <typename ExecutionPolicy>
+void TestParallelMatchDocumentsImpl(std::string_view mark, const SearchServer& search_server, const std::string& query, ExecutionPolicy&& policy) {
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    LOG_DURATION(mark);
+    int word_count = 0;
+    for (const auto& [words, status] : search_server.MatchDocuments(policy, query, document_ids)) {
         word_count += words.size();
     }
 }
@@ -137,14 +216,52 @@ void TestParallelFindTopDocumentsImpl(std::string_view mark, const SearchServer&
     std::cerr << "Total_relevance: " << total_relevance << std::endl;
 }
 
+template <typename ExecutionPolicy>
+std::vector<std::vector<Document>> TestScoreAccumulatorImpl(std::string_view mark, const SearchServer& search_server, const std::vector<std::string>& queries,
+                                                            ExecutionPolicy&& policy, ScoreAccumulatorType accumulator) {
+    LOG_DURATION(mark);
+    std::vector<std::vector<Document>> results;
+    results.reserve(queries.size());
+    double total_relevance = 0;
+    for (const std::string_view query : queries) {
+        results.push_back(search_server.FindTopDocuments(policy, query, DocumentStatus::ACTUAL, {MAX_RESULT_DOCUMENT_COUNT, accumulator}));
+        for (const auto& document : results.back()) {
+            total_relevance += document.relevance;
+        }
+    }
+    std::cerr << "Total_relevance: " << total_relevance << std::endl;
+    return results;
+}
+
+template <typename ExecutionPolicy>
+SearchServer TestAddDocumentsImpl(std::string_view mark, const std::vector<std::string>& texts, ExecutionPolicy&& policy) {
+    std::vector<NewDocument> documents;
+    documents.reserve(texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        documents.push_back({static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, {1, 2, 3}});
+    }
+    SearchServer search_server(texts[0].substr(0, texts[0].find(' ')));
+    {
+        LOG_DURATION(mark);
+        search_server.AddDocuments(policy, documents);
+    }
+    return search_server;
+}
+
 #define TEST_QUERIES_PROCESSOR(processor) TestQueriesProcessorImpl(#processor, processor, search_server, queries)
 
 #define TEST_PARALLEL_REMOVE(policy) TestParallelRemoveDocumentImpl(#policy, search_server, std::execution::policy)
 
 #define TEST_PARALLEL_MATCH_DOCUMENT(policy) TestParallelMatchDocumentImpl(#policy, search_server, query, std::execution::policy)
 
+#define TEST_PARALLEL_MATCH_DOCUMENTS(policy) TestParallelMatchDocumentsImpl("MatchDocuments "s #policy, search_server, query, std::execution::policy)
+
 #define TEST_PARALLEL_FIND_DOCUMENTS(policy) TestParallelFindTopDocumentsImpl(#policy, search_server, queries, std::execution::policy)
 
+#define TEST_SCORE_ACCUMULATOR(accumulator) TestScoreAccumulatorImpl(#accumulator, search_server, queries, std::execution::seq, ScoreAccumulatorType::accumulator)
+
+#define TEST_ADD_DOCUMENTS(policy) TestAddDocumentsImpl(#policy, documents, std::execution::policy)
+
 #define RUN_TEST(func)  RunTestImpl((func), #func)
 
 
@@ -156,5 +273,14 @@ void TestParallelMatchDocument();
 
 void TestParallelFindTopDocuments();
 
+// Сравнение накопителей релевантности: результаты совпадают, время выводится для каждого
+void TestScoreAccumulators();
+
+// Сравнение пакетного добавления с добавлением по одному документу
+void TestAddDocuments();
+
+// Добавление документов вперемешку с запросами: каждый запрос публикует новый снимок индекса
+void TestInterleavedAddAndFind();
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer();
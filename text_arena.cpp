@@ -0,0 +1,49 @@
+#include "text_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+TextArena::Chunk::Chunk(size_t capacity)
+        : data(new char[capacity])
+        , capacity(capacity) {
+}
+
+TextArena::TextArena(const TextArena& other)
+        : chunks_(other.chunks_)
+        , capacity_(other.capacity_.load(std::memory_order_relaxed)) {
+}
+
+TextArena& TextArena::operator=(const TextArena& other) {
+    chunks_ = other.chunks_;
+    capacity_.store(other.capacity_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+}
+
+std::string_view TextArena::Append(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    if (!chunks_.empty()) {
+        Chunk& chunk = *chunks_.back();
+        // Если текст не поместился, счетчик все равно вышел за границу куска и кусок закрыт для всех копий
+        const size_t offset = chunk.used.fetch_add(text.size(), std::memory_order_relaxed);
+        if (offset + text.size() <= chunk.capacity) {
+            std::memcpy(chunk.data.get() + offset, text.data(), text.size());
+            return {chunk.data.get() + offset, text.size()};
+        }
+    }
+    // Текст длиннее куска получает собственный кусок
+    Chunk& chunk = *chunks_.emplace_back(std::make_shared<Chunk>(std::max(CHUNK_SIZE, text.size())));
+    chunk.used.store(text.size(), std::memory_order_relaxed);
+    capacity_.fetch_add(chunk.capacity, std::memory_order_relaxed);
+    std::memcpy(chunk.data.get(), text.data(), text.size());
+    return {chunk.data.get(), text.size()};
+}
+
+size_t TextArena::GetChunkCount() const {
+    return chunks_.size();
+}
+
+size_t TextArena::GetCapacity() const {
+    return capacity_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Хранилище текстов документов: тексты копируются подряд в куски по CHUNK_SIZE байт,
+// поэтому память выделяется один раз на кусок, а не на каждый документ.
+// Скопированные тексты не перемещаются и действительны, пока жив хотя бы один владелец куска.
+// Копии хранилища разделяют куски. Место в последнем куске занимается атомарно,
+// поэтому копии могут дописывать тексты независимо, не затирая тексты друг друга
+class TextArena {
+public:
+    static constexpr size_t CHUNK_SIZE = 1 << 20;
+
+    TextArena() = default;
+    TextArena(const TextArena& other);
+    TextArena& operator=(const TextArena& other);
+
+    // Копирование текста в хранилище
+    std::string_view Append(std::string_view text);
+
+    [[nodiscard]] size_t GetChunkCount() const;
+
+    // Память, выделенная под куски. Можно вызывать одновременно с Append
+    [[nodiscard]] size_t GetCapacity() const;
+
+private:
+    struct Chunk {
+        explicit Chunk(size_t capacity);
+
+        std::unique_ptr<char[]> data;
+        size_t capacity;
+        std::atomic<size_t> used = 0;
+    };
+
+    std::vector<std::shared_ptr<Chunk>> chunks_;
+    std::atomic<size_t> capacity_ = 0;
+};
@@ -0,0 +1,54 @@
+#include "top_documents_collector.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
+        if (lhs.rating == rhs.rating) {
+            return lhs.id < rhs.id;
+        }
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+TopDocumentsCollector::TopDocumentsCollector(size_t top_k)
+        : top_k_(top_k) {
+}
+
+void TopDocumentsCollector::Reserve(size_t document_count) {
+    heap_.reserve(std::min(top_k_, heap_.size() + std::min(document_count, top_k_)));
+}
+
+void TopDocumentsCollector::Add(const Document& document) {
+    if (heap_.size() < top_k_) {
+        heap_.push_back(document);
+        std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    } else if (top_k_ > 0 && IsMoreRelevant(document, heap_.front())) {
+        std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        heap_.back() = document;
+        std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    }
+}
+
+void TopDocumentsCollector::Merge(const TopDocumentsCollector& other) {
+    Reserve(other.heap_.size());
+    for (const Document& document : other.heap_) {
+        Add(document);
+    }
+}
+
+std::vector<Document> TopDocumentsCollector::Extract() && {
+    std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    return std::move(heap_);
+}
+
+std::vector<Document> CollectTopDocuments(const std::execution::sequenced_policy&, const std::vector<Document>& documents, size_t top_k) {
+    TopDocumentsCollector collector(top_k);
+    collector.Reserve(documents.size());
+    for (const Document& document : documents) {
+        collector.Add(document);
+    }
+    return std::move(collector).Extract();
+}
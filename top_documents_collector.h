@@ -0,0 +1,36 @@
+#pragma once
+
+#include <execution>
+#include <vector>
+
+#include "document.h"
+
+// Документ lhs релевантнее rhs: сравнение по релевантности, при равной релевантности - по рейтингу,
+// при равном рейтинге - по id, чтобы порядок выдачи не зависел от порядка обхода
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+// Ограниченная куча для отбора top_k наиболее релевантных документов.
+// На вершине кучи находится наименее релевантный из отобранных документов
+class TopDocumentsCollector {
+public:
+    // Память под top_k документов заранее не выделяется: top_k может быть намного больше числа найденных
+    explicit TopDocumentsCollector(size_t top_k);
+
+    // Выделение памяти под document_count документов, которые будут добавлены, но не больше чем под top_k
+    void Reserve(size_t document_count);
+
+    void Add(const Document& document);
+
+    // Добавление документов, отобранных другим сборщиком
+    void Merge(const TopDocumentsCollector& other);
+
+    // Возвращает отобранные документы в порядке убывания релевантности
+    [[nodiscard]] std::vector<Document> Extract() &&;
+
+private:
+    size_t top_k_;
+    std::vector<Document> heap_;
+};
+
+// Отбор top_k наиболее релевантных документов. Последовательная версия
+std::vector<Document> CollectTopDocuments(const std::execution::sequenced_policy&, const std::vector<Document>& documents, size_t top_k);
@@ -0,0 +1,38 @@
+#include "word_frequencies.h"
+
+#include <algorithm>
+
+WordFrequencies::WordFrequencies(std::shared_ptr<const IndexSegment> segment,
+                                 std::shared_ptr<const TermDictionary> term_dictionary, WordFreqsView word_freqs)
+        : segment_(std::move(segment))
+        , term_dictionary_(std::move(term_dictionary))
+        , word_freqs_(word_freqs) {
+}
+
+std::optional<double> WordFrequencies::Find(std::string_view word) const {
+    if (empty()) {
+        return std::nullopt;
+    }
+    const auto term_id = term_dictionary_->Find(word);
+    if (!term_id) {
+        return std::nullopt;
+    }
+    const ArrayView<TermId> term_ids = word_freqs_.term_ids;
+    const auto found = std::lower_bound(term_ids.begin(), term_ids.end(), *term_id);
+    if (found == term_ids.end() || *found != *term_id) {
+        return std::nullopt;
+    }
+    return word_freqs_.term_freqs[found - term_ids.begin()];
+}
+
+WordFrequencies::value_type WordFrequencies::GetWordFrequency(size_t index) const {
+    return {term_dictionary_->GetTerm(word_freqs_.term_ids[index]), word_freqs_.term_freqs[index]};
+}
+
+bool operator==(const WordFrequencies& lhs, const WordFrequencies& rhs) {
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+bool operator!=(const WordFrequencies& lhs, const WordFrequencies& rhs) {
+    return !(lhs == rhs);
+}
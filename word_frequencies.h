@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "array_view.h"
+#include "index_segment.h"
+#include "term_dictionary.h"
+
+// Частоты слов документа без копирования: id термов и частоты читаются прямо из прямого индекса сегмента,
+// а слова - из словаря термов. Вид держит сегмент и словарь, поэтому остается действительным
+// и после изменения сервера. Слова обходятся в порядке возрастания id термов
+class WordFrequencies {
+public:
+    using value_type = std::pair<std::string_view, double>;
+
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = WordFrequencies::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        // Пара строится при разыменовании, поэтому -> возвращает временную копию пары
+        struct ArrowProxy {
+            value_type value;
+
+            const value_type* operator->() const {
+                return &value;
+            }
+        };
+
+        Iterator(const WordFrequencies* frequencies, size_t index)
+                : frequencies_(frequencies)
+                , index_(index) {
+        }
+
+        [[nodiscard]] value_type operator*() const {
+            return frequencies_->GetWordFrequency(index_);
+        }
+
+        [[nodiscard]] ArrowProxy operator->() const {
+            return {**this};
+        }
+
+        Iterator& operator++() {
+            ++index_;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++index_;
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return index_ == other.index_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return index_ != other.index_;
+        }
+
+    private:
+        const WordFrequencies* frequencies_;
+        size_t index_;
+    };
+
+    // Пустой вид: документа нет
+    WordFrequencies() = default;
+
+    WordFrequencies(std::shared_ptr<const IndexSegment> segment, std::shared_ptr<const TermDictionary> term_dictionary,
+                    WordFreqsView word_freqs);
+
+    [[nodiscard]] Iterator begin() const {
+        return {this, 0};
+    }
+
+    [[nodiscard]] Iterator end() const {
+        return {this, size()};
+    }
+
+    [[nodiscard]] size_t size() const {
+        return word_freqs_.term_ids.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return word_freqs_.term_ids.empty();
+    }
+
+    // Частота слова в документе или std::nullopt, если слова в документе нет
+    [[nodiscard]] std::optional<double> Find(std::string_view word) const;
+
+    // Id термов документа по возрастанию
+    [[nodiscard]] ArrayView<TermId> GetTermIds() const {
+        return word_freqs_.term_ids;
+    }
+
+    // Частоты термов в порядке GetTermIds
+    [[nodiscard]] ArrayView<double> GetTermFreqs() const {
+        return word_freqs_.term_freqs;
+    }
+
+private:
+    std::shared_ptr<const IndexSegment> segment_;
+    std::shared_ptr<const TermDictionary> term_dictionary_;
+    WordFreqsView word_freqs_;
+
+    [[nodiscard]] value_type GetWordFrequency(size_t index) const;
+};
+
+// Виды равны, если в документах одни и те же слова с одинаковыми частотами
+bool operator==(const WordFrequencies& lhs, const WordFrequencies& rhs);
+bool operator!=(const WordFrequencies& lhs, const WordFrequencies& rhs);